@@ -0,0 +1,11 @@
+#ifndef __DRIVER_FAKE_H__
+#define __DRIVER_FAKE_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief Edge on a pin for every PCNT channel listening to it
+ */
+void pcnt_fake_edge(int gpio_num, bool rising);
+
+#endif // __DRIVER_FAKE_H__
@@ -0,0 +1,152 @@
+#include <driver/gpio.h>
+#include <driver_fake.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+  int level;
+  gpio_int_type_t intr_type;
+  bool intr_enabled;
+  gpio_isr_t handler;
+  void *args;
+} pin_t;
+
+static pin_t pins[GPIO_NUM_MAX];
+static bool isr_service = false;
+
+static bool valid(gpio_num_t gpio_num) { return GPIO_IS_VALID_GPIO(gpio_num); }
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig) {
+  if (pGPIOConfig == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (int gpio_num = 0; gpio_num < GPIO_NUM_MAX; gpio_num++) {
+    if (pGPIOConfig->pin_bit_mask & (1ULL << gpio_num)) {
+      pins[gpio_num].intr_type = pGPIOConfig->intr_type;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].intr_type = GPIO_INTR_DISABLE;
+  pins[gpio_num].intr_enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+  return valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) {
+  return valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  gpio_fake_set_level(gpio_num, level != 0);
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+  return valid(gpio_num) ? pins[gpio_num].level : 0;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+  if (!valid(gpio_num) || intr_type >= GPIO_INTR_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].intr_type = intr_type;
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].intr_enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].intr_enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+  if (isr_service) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  isr_service = true;
+  return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void) { isr_service = false; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler,
+                               void *args) {
+  if (!isr_service) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].handler = isr_handler;
+  pins[gpio_num].args = args;
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+  if (!valid(gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pins[gpio_num].handler = NULL;
+  return ESP_OK;
+}
+
+static bool triggers(const pin_t *pin, bool rising) {
+  switch (pin->intr_type) {
+  case GPIO_INTR_POSEDGE:
+    return rising;
+  case GPIO_INTR_NEGEDGE:
+    return !rising;
+  case GPIO_INTR_ANYEDGE:
+    return true;
+  case GPIO_INTR_LOW_LEVEL:
+    return !rising;
+  case GPIO_INTR_HIGH_LEVEL:
+    return rising;
+  default:
+    return false;
+  }
+}
+
+void gpio_fake_set_level(gpio_num_t gpio_num, int level) {
+  if (!valid(gpio_num)) {
+    return;
+  }
+
+  pin_t *pin = &pins[gpio_num];
+  level = level != 0;
+  if (pin->level == level) {
+    return;
+  }
+  pin->level = level;
+
+  /* The GPIO ISR goes first, the capture ring must hold the edge by the time
+   * the watch point of the same edge asks for it. */
+  if (isr_service && pin->intr_enabled && pin->handler != NULL &&
+      triggers(pin, level)) {
+    pin->handler(pin->args);
+  }
+  pcnt_fake_edge(gpio_num, level);
+}
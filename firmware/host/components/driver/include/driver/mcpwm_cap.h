@@ -0,0 +1,74 @@
+#ifndef __DRIVER_MCPWM_CAP_H__
+#define __DRIVER_MCPWM_CAP_H__
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Host fake of the MCPWM capture, only the API. There is no capture timer on
+ * the host, every call is ESP_ERR_NOT_SUPPORTED and the host build uses the
+ * GPIO backend of the capture. */
+
+typedef struct mcpwm_cap_timer_t *mcpwm_cap_timer_handle_t;
+typedef struct mcpwm_cap_channel_t *mcpwm_cap_channel_handle_t;
+
+typedef enum {
+  MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+  MCPWM_CAPTURE_CLK_SRC_APB,
+} mcpwm_capture_clock_source_t;
+
+typedef enum {
+  MCPWM_CAP_EDGE_POS,
+  MCPWM_CAP_EDGE_NEG,
+} mcpwm_capture_edge_t;
+
+typedef struct {
+  int group_id;
+  mcpwm_capture_clock_source_t clk_src;
+} mcpwm_capture_timer_config_t;
+
+typedef struct {
+  int gpio_num;
+  int intr_priority;
+  uint32_t prescale;
+  struct {
+    uint32_t pos_edge : 1;
+    uint32_t neg_edge : 1;
+    uint32_t pull_up : 1;
+    uint32_t pull_down : 1;
+    uint32_t invert_cap_signal : 1;
+    uint32_t io_loop_back : 1;
+    uint32_t keep_io_conf_at_exit : 1;
+  } flags;
+} mcpwm_capture_channel_config_t;
+
+typedef struct {
+  uint32_t cap_value;
+  mcpwm_capture_edge_t cap_edge;
+} mcpwm_capture_event_data_t;
+
+typedef bool (*mcpwm_capture_event_cb_t)(
+    mcpwm_cap_channel_handle_t cap_channel,
+    const mcpwm_capture_event_data_t *edata, void *user_data);
+
+typedef struct {
+  mcpwm_capture_event_cb_t on_cap;
+} mcpwm_capture_event_callbacks_t;
+
+esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t *config,
+                                  mcpwm_cap_timer_handle_t *ret_cap_timer);
+esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t cap_timer);
+esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t cap_timer);
+esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t cap_timer,
+                                             uint32_t *out_resolution);
+esp_err_t
+mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t cap_timer,
+                          const mcpwm_capture_channel_config_t *config,
+                          mcpwm_cap_channel_handle_t *ret_cap_channel);
+esp_err_t mcpwm_capture_channel_register_event_callbacks(
+    mcpwm_cap_channel_handle_t cap_channel,
+    const mcpwm_capture_event_callbacks_t *cbs, void *user_data);
+esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t cap_channel);
+esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t cap_channel);
+
+#endif // __DRIVER_MCPWM_CAP_H__
@@ -0,0 +1,25 @@
+#ifndef __DRIVER_UART_H__
+#define __DRIVER_UART_H__
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Host fake of the UART driver. What is written goes to the file named by
+ * PHOTOGATE_UART, or nowhere, nothing is ever received. */
+
+typedef int uart_port_t;
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size,
+                              int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_driver_delete(uart_port_t uart_num);
+bool uart_is_driver_installed(uart_port_t uart_num);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length,
+                    TickType_t ticks_to_wait);
+
+#endif // __DRIVER_UART_H__
@@ -0,0 +1,67 @@
+#ifndef __HAL_LEDC_TYPES_H__
+#define __HAL_LEDC_TYPES_H__
+
+typedef enum {
+  LEDC_HIGH_SPEED_MODE,
+  LEDC_LOW_SPEED_MODE,
+  LEDC_SPEED_MODE_MAX,
+} ledc_mode_t;
+
+typedef enum {
+  LEDC_INTR_DISABLE,
+  LEDC_INTR_FADE_END,
+  LEDC_INTR_MAX,
+} ledc_intr_type_t;
+
+typedef enum {
+  LEDC_AUTO_CLK,
+  LEDC_USE_APB_CLK,
+  LEDC_USE_RC_FAST_CLK,
+  LEDC_USE_REF_TICK,
+} ledc_clk_cfg_t;
+
+typedef enum {
+  LEDC_TIMER_0,
+  LEDC_TIMER_1,
+  LEDC_TIMER_2,
+  LEDC_TIMER_3,
+  LEDC_TIMER_MAX,
+} ledc_timer_t;
+
+typedef enum {
+  LEDC_CHANNEL_0,
+  LEDC_CHANNEL_1,
+  LEDC_CHANNEL_2,
+  LEDC_CHANNEL_3,
+  LEDC_CHANNEL_4,
+  LEDC_CHANNEL_5,
+  LEDC_CHANNEL_6,
+  LEDC_CHANNEL_7,
+  LEDC_CHANNEL_MAX,
+} ledc_channel_t;
+
+typedef enum {
+  LEDC_TIMER_1_BIT = 1,
+  LEDC_TIMER_2_BIT,
+  LEDC_TIMER_3_BIT,
+  LEDC_TIMER_4_BIT,
+  LEDC_TIMER_5_BIT,
+  LEDC_TIMER_6_BIT,
+  LEDC_TIMER_7_BIT,
+  LEDC_TIMER_8_BIT,
+  LEDC_TIMER_9_BIT,
+  LEDC_TIMER_10_BIT,
+  LEDC_TIMER_11_BIT,
+  LEDC_TIMER_12_BIT,
+  LEDC_TIMER_13_BIT,
+  LEDC_TIMER_14_BIT,
+  LEDC_TIMER_15_BIT,
+  LEDC_TIMER_16_BIT,
+  LEDC_TIMER_17_BIT,
+  LEDC_TIMER_18_BIT,
+  LEDC_TIMER_19_BIT,
+  LEDC_TIMER_20_BIT,
+  LEDC_TIMER_BIT_MAX,
+} ledc_timer_bit_t;
+
+#endif // __HAL_LEDC_TYPES_H__
@@ -0,0 +1,55 @@
+#include <driver/ledc.h>
+#include <stdbool.h>
+
+typedef struct {
+  bool configured;
+  uint32_t duty;   // set, waits for ledc_update_duty
+  uint32_t output; // on the pin
+} channel_t;
+
+static channel_t channels[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+
+static bool valid(ledc_mode_t speed_mode, ledc_channel_t channel) {
+  return speed_mode < LEDC_SPEED_MODE_MAX && channel < LEDC_CHANNEL_MAX;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf) {
+  if (timer_conf == NULL || timer_conf->timer_num >= LEDC_TIMER_MAX ||
+      timer_conf->freq_hz == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf) {
+  if (ledc_conf == NULL || !valid(ledc_conf->speed_mode, ledc_conf->channel)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  channel_t *chan = &channels[ledc_conf->speed_mode][ledc_conf->channel];
+  chan->configured = true;
+  chan->duty = ledc_conf->duty;
+  chan->output = ledc_conf->duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel,
+                        uint32_t duty) {
+  if (!valid(speed_mode, channel) || !channels[speed_mode][channel].configured) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channels[speed_mode][channel].duty = duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+  if (!valid(speed_mode, channel) || !channels[speed_mode][channel].configured) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channels[speed_mode][channel].output = channels[speed_mode][channel].duty;
+  return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel) {
+  return valid(speed_mode, channel) ? channels[speed_mode][channel].output : 0;
+}
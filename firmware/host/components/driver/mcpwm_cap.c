@@ -0,0 +1,40 @@
+#include <driver/mcpwm_cap.h>
+
+esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t *config,
+                                  mcpwm_cap_timer_handle_t *ret_cap_timer) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t cap_timer) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t cap_timer) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t cap_timer,
+                                             uint32_t *out_resolution) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t
+mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t cap_timer,
+                          const mcpwm_capture_channel_config_t *config,
+                          mcpwm_cap_channel_handle_t *ret_cap_channel) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_channel_register_event_callbacks(
+    mcpwm_cap_channel_handle_t cap_channel,
+    const mcpwm_capture_event_callbacks_t *cbs, void *user_data) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t cap_channel) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t cap_channel) {
+  return ESP_ERR_NOT_SUPPORTED;
+}
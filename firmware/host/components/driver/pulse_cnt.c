@@ -0,0 +1,376 @@
+#include <driver/pulse_cnt.h>
+#include <driver_fake.h>
+#include <esp_timer.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define FAKE_UNITS 8
+#define FAKE_CHANNELS 2
+#define FAKE_WATCH_POINTS (PCNT_FAKE_FREE_WATCH_POINTS + 3)
+
+struct pcnt_chan_t {
+  pcnt_unit_handle_t unit;
+  int edge_gpio_num;
+  bool invert;
+  pcnt_channel_edge_action_t pos_act;
+  pcnt_channel_edge_action_t neg_act;
+};
+
+struct pcnt_unit_t {
+  int low_limit;
+  int high_limit;
+  int count;
+  bool enabled;
+  bool running;
+  uint32_t max_glitch_ns;
+  esp_timer_handle_t filter_timer;
+  bool pending; // edge held by the glitch filter
+  int pending_gpio;
+  bool pending_rising;
+  int watch[FAKE_WATCH_POINTS];
+  uint8_t watchers;
+  pcnt_watch_cb_t on_reach;
+  void *user_ctx;
+  struct pcnt_chan_t *channels[FAKE_CHANNELS];
+};
+
+static struct pcnt_unit_t *units[FAKE_UNITS];
+static uint32_t reached = 0;
+
+static void filter_pass(void *args);
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config,
+                        pcnt_unit_handle_t *ret_unit) {
+  if (config == NULL || ret_unit == NULL || config->low_limit >= 0 ||
+      config->high_limit <= 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (size_t i = 0; i < FAKE_UNITS; i++) {
+    if (units[i] == NULL) {
+      struct pcnt_unit_t *unit = calloc(1, sizeof(struct pcnt_unit_t));
+      if (unit == NULL) {
+        return ESP_ERR_NO_MEM;
+      }
+      unit->low_limit = config->low_limit;
+      unit->high_limit = config->high_limit;
+      esp_timer_create_args_t filter_args = {
+          .callback = filter_pass,
+          .arg = unit,
+          .name = "pcnt_filter",
+      };
+      esp_err_t err = esp_timer_create(&filter_args, &unit->filter_timer);
+      if (err != ESP_OK) {
+        free(unit);
+        return err;
+      }
+      units[i] = unit;
+      *ret_unit = unit;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  for (size_t i = 0; i < FAKE_UNITS; i++) {
+    if (units[i] == unit) {
+      units[i] = NULL;
+    }
+  }
+  esp_timer_delete(unit->filter_timer);
+  free(unit);
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit,
+                                      const pcnt_glitch_filter_config_t *config) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->max_glitch_ns = config != NULL ? config->max_glitch_ns : 0;
+  return ESP_OK;
+}
+
+static void drop_pending(pcnt_unit_handle_t unit) {
+  if (unit->pending) {
+    esp_timer_stop(unit->filter_timer);
+    unit->pending = false;
+  }
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->enabled = false;
+  unit->running = false;
+  drop_pending(unit);
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->running = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->running = false;
+  drop_pending(unit);
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  unit->count = 0;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value) {
+  if (unit == NULL || value == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *value = unit->count;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_register_event_callbacks(pcnt_unit_handle_t unit,
+                                             const pcnt_event_callbacks_t *cbs,
+                                             void *user_data) {
+  if (unit == NULL || cbs == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  unit->on_reach = cbs->on_reach;
+  unit->user_ctx = user_data;
+  return ESP_OK;
+}
+
+static bool free_point(pcnt_unit_handle_t unit, int value) {
+  return value != 0 && value != unit->low_limit && value != unit->high_limit;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int watch_point) {
+  if (unit == NULL || watch_point < unit->low_limit ||
+      watch_point > unit->high_limit) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  uint8_t used = 0;
+  for (uint8_t i = 0; i < unit->watchers; i++) {
+    if (unit->watch[i] == watch_point) {
+      return ESP_ERR_INVALID_STATE;
+    }
+    used += free_point(unit, unit->watch[i]);
+  }
+  if (free_point(unit, watch_point) && used == PCNT_FAKE_FREE_WATCH_POINTS) {
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  unit->watch[unit->watchers++] = watch_point;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_remove_watch_point(pcnt_unit_handle_t unit,
+                                       int watch_point) {
+  if (unit == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (uint8_t i = 0; i < unit->watchers; i++) {
+    if (unit->watch[i] == watch_point) {
+      unit->watch[i] = unit->watch[--unit->watchers];
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit,
+                           const pcnt_chan_config_t *config,
+                           pcnt_channel_handle_t *ret_chan) {
+  if (unit == NULL || config == NULL || ret_chan == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (unit->enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  for (size_t i = 0; i < FAKE_CHANNELS; i++) {
+    if (unit->channels[i] == NULL) {
+      struct pcnt_chan_t *chan = calloc(1, sizeof(struct pcnt_chan_t));
+      if (chan == NULL) {
+        return ESP_ERR_NO_MEM;
+      }
+      chan->unit = unit;
+      chan->edge_gpio_num = config->edge_gpio_num;
+      chan->invert = config->flags.invert_edge_input;
+      unit->channels[i] = chan;
+      *ret_chan = chan;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan) {
+  if (chan == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (size_t i = 0; i < FAKE_CHANNELS; i++) {
+    if (chan->unit->channels[i] == chan) {
+      chan->unit->channels[i] = NULL;
+    }
+  }
+  free(chan);
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan,
+                                       pcnt_channel_edge_action_t pos_act,
+                                       pcnt_channel_edge_action_t neg_act) {
+  if (chan == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  chan->pos_act = pos_act;
+  chan->neg_act = neg_act;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan,
+                                        pcnt_channel_level_action_t high_act,
+                                        pcnt_channel_level_action_t low_act) {
+  // there is no level input on the fake, KEEP is the only behaviour
+  return chan != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static void reach(pcnt_unit_handle_t unit, int value,
+                  pcnt_unit_zero_cross_mode_t mode) {
+  if (unit->on_reach == NULL) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < unit->watchers; i++) {
+    if (unit->watch[i] == value) {
+      pcnt_watch_event_data_t edata = {
+          .watch_point_value = value,
+          .zero_cross_mode = mode,
+      };
+      reached++;
+      unit->on_reach(unit, &edata, unit->user_ctx);
+      return;
+    }
+  }
+}
+
+static void step(pcnt_unit_handle_t unit, pcnt_channel_edge_action_t action) {
+  if (action == PCNT_CHANNEL_EDGE_ACTION_HOLD) {
+    return;
+  }
+
+  unit->count += action == PCNT_CHANNEL_EDGE_ACTION_INCREASE ? 1 : -1;
+  reach(unit, unit->count, PCNT_UNIT_ZERO_CROSS_POS_ZERO);
+
+  if (unit->count == unit->high_limit || unit->count == unit->low_limit) {
+    pcnt_unit_zero_cross_mode_t mode = unit->count > 0
+                                           ? PCNT_UNIT_ZERO_CROSS_POS_ZERO
+                                           : PCNT_UNIT_ZERO_CROSS_NEG_ZERO;
+    unit->count = 0;
+    reach(unit, 0, mode);
+  }
+}
+
+static void count_edge(pcnt_unit_handle_t unit, int gpio_num, bool rising) {
+  for (size_t c = 0; c < FAKE_CHANNELS; c++) {
+    struct pcnt_chan_t *chan = unit->channels[c];
+    if (chan != NULL && chan->edge_gpio_num == gpio_num) {
+      step(unit, rising != chan->invert ? chan->pos_act : chan->neg_act);
+    }
+  }
+}
+
+// The level held for max_glitch_ns, the edge is real
+static void filter_pass(void *args) {
+  pcnt_unit_handle_t unit = args;
+
+  unit->pending = false;
+  if (unit->running) {
+    count_edge(unit, unit->pending_gpio, unit->pending_rising);
+  }
+}
+
+uint32_t pcnt_fake_reached(void) { return reached; }
+
+void pcnt_fake_edge(int gpio_num, bool rising) {
+  for (size_t u = 0; u < FAKE_UNITS; u++) {
+    pcnt_unit_handle_t unit = units[u];
+    if (unit == NULL || !unit->running) {
+      continue;
+    }
+
+    bool listens = false;
+    for (size_t c = 0; c < FAKE_CHANNELS; c++) {
+      listens |= unit->channels[c] != NULL &&
+                 unit->channels[c]->edge_gpio_num == gpio_num;
+    }
+    if (!listens) {
+      continue;
+    }
+
+    if (unit->max_glitch_ns == 0) {
+      count_edge(unit, gpio_num, rising);
+    } else if (unit->pending) {
+      // Back to the old level before the filter let it pass, both are gone
+      drop_pending(unit);
+    } else {
+      /* Held like the hardware filter does, rounded up to the microsecond of
+       * the esp_timer, so every counted edge is late by the same amount. */
+      unit->pending = true;
+      unit->pending_gpio = gpio_num;
+      unit->pending_rising = rising;
+      esp_timer_start_once(unit->filter_timer,
+                           (unit->max_glitch_ns + 999) / 1000);
+    }
+  }
+}
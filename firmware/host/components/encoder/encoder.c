@@ -0,0 +1,74 @@
+#include <encoder.h>
+#include <event_script.h>
+#include <freertos/task.h>
+
+static QueueHandle_t events = NULL;
+static rotary_encoder_t *encoder = NULL;
+
+esp_err_t rotary_encoder_init(QueueHandle_t queue) {
+  if (queue == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (events != NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  events = queue;
+  return event_script_start();
+}
+
+esp_err_t rotary_encoder_add(rotary_encoder_t *re) {
+  if (re == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  re->btn_state = RE_BTN_RELEASED;
+  encoder = re;
+  return ESP_OK;
+}
+
+esp_err_t rotary_encoder_remove(rotary_encoder_t *re) {
+  if (re == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (encoder == re) {
+    encoder = NULL;
+  }
+  return ESP_OK;
+}
+
+esp_err_t rotary_encoder_enable_acceleration(rotary_encoder_t *re,
+                                             uint16_t coeff) {
+  return re != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t rotary_encoder_disable_acceleration(rotary_encoder_t *re) {
+  return re != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void rotary_encoder_fake_send(rotary_encoder_event_type_t type, int32_t diff) {
+  if (events == NULL || encoder == NULL) {
+    return;
+  }
+
+  switch (type) {
+  case RE_ET_BTN_PRESSED:
+    encoder->btn_state = RE_BTN_PRESSED;
+    break;
+  case RE_ET_BTN_LONG_PRESSED:
+    encoder->btn_state = RE_BTN_LONG_PRESSED;
+    break;
+  case RE_ET_BTN_RELEASED:
+    encoder->btn_state = RE_BTN_RELEASED;
+    break;
+  default:
+    break;
+  }
+
+  rotary_encoder_event_t e = {
+      .type = type,
+      .sender = encoder,
+      .diff = diff,
+  };
+  xQueueSend(events, &e, portMAX_DELAY);
+}
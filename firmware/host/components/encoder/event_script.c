@@ -0,0 +1,259 @@
+#include <ctype.h>
+#include <driver/gpio.h>
+#include <encoder.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <event_script.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <hd44780.h>
+#include <inttypes.h>
+#include <sdkconfig.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <virtual_clock.h>
+
+/* One event per line, '#' starts a comment:
+ *
+ *   <time> <event> [arguments]
+ *
+ * <time> is on the virtual clock, in us unless it ends with ms or s, and a
+ * leading '+' makes it relative to the end of the previous line. The clock
+ * moves to that time first, firing the timers due on the way, then the event
+ * runs:
+ *
+ *   sensor <0|1>                  level of the IR sensor
+ *   pin <gpio> <0|1>              level of any pin
+ *   pulses <n> <period> <width>   n high pulses on the sensor, period apart
+ *   turn <steps> [interval]       the encoder, negative turns left; the
+ *                                 detents are interval apart, or all at once
+ *                                 as the fastest spin
+ *   click                         short press of the button
+ *   long                          long press of the button
+ *   lcd                           print the screen
+ *   expect <line> <text>          fail when the line does not contain text
+ *                                 (both wait for the display task to flush)
+ *   quit                          leave, the status is the failed expects
+ *
+ * and the events that the firmware added with event_script_add.
+ *
+ * The task has the idle priority, so a line only runs once every task of the
+ * firmware is blocked, and the run is the same whatever the host does. The
+ * polls of the experiments are esp_timer ticks, so they wait for the virtual
+ * clock too and never let a line run in the middle of a real wait. */
+
+#define SCRIPT_LINE_SIZE 256
+// The display flushes on frames of real time, longer than one of them
+#define SCRIPT_SCREEN_WAIT_MS 100
+
+static const char *TAG = "script";
+
+typedef struct {
+  const char *event;
+  event_script_handler_t handler;
+} script_event_t;
+
+static FILE *script = NULL;
+static unsigned failures = 0;
+static script_event_t added[EVENT_SCRIPT_HANDLERS];
+static size_t added_size = 0;
+
+esp_err_t event_script_add(const char *event, event_script_handler_t handler) {
+  if (event == NULL || handler == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (added_size == EVENT_SCRIPT_HANDLERS) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  added[added_size].event = event;
+  added[added_size].handler = handler;
+  added_size++;
+  return ESP_OK;
+}
+
+void event_script_fail(void) { failures++; }
+
+bool event_script_duration(const char *text, int64_t *ns) {
+  char *end;
+  int64_t value = strtoll(text, &end, 10);
+
+  if (end == text || value < 0) {
+    return false;
+  }
+  if (strcmp(end, "s") == 0) {
+    value *= 1000000;
+  } else if (strcmp(end, "ms") == 0) {
+    value *= 1000;
+  } else if (*end != '\0' && strcmp(end, "us") != 0) {
+    return false;
+  }
+
+  *ns = value * 1000;
+  return true;
+}
+
+static bool parse_time(const char *text, int64_t *ns) {
+  if (*text != '+') {
+    return event_script_duration(text, ns);
+  }
+  if (!event_script_duration(text + 1, ns)) {
+    return false;
+  }
+  *ns += virtual_clock_now_ns();
+  return true;
+}
+
+void event_script_settle(void) { taskYIELD(); }
+
+static void set_pin(int gpio, int level) {
+  gpio_fake_set_level(gpio, level);
+  event_script_settle();
+}
+
+static void press(rotary_encoder_event_type_t type) {
+  rotary_encoder_fake_send(type, 0);
+  event_script_settle();
+}
+
+static void pulses(int gpio, unsigned n, int64_t period, int64_t width) {
+  int64_t start = virtual_clock_now_ns();
+
+  for (unsigned i = 0; i < n; i++) {
+    virtual_clock_advance(start + i * period);
+    set_pin(gpio, 1);
+    virtual_clock_advance(start + i * period + width);
+    set_pin(gpio, 0);
+  }
+}
+
+static void wait_screen(void) { vTaskDelay(pdMS_TO_TICKS(SCRIPT_SCREEN_WAIT_MS)); }
+
+static void expect(unsigned number, unsigned line, const char *text) {
+  char shown[HD44780_FAKE_COLUMNS + 1];
+
+  wait_screen();
+  hd44780_fake_line(line, shown);
+  if (strstr(shown, text) == NULL) {
+    failures++;
+    ESP_LOGE(TAG, "line %u: expected \"%s\" on %u, got \"%s\"", number, text,
+             line, shown);
+  }
+}
+
+static void quit(void) {
+  ESP_LOGI(TAG, "done at %" PRId64 "us, %u failed", esp_timer_get_time(),
+           failures);
+  fflush(stdout);
+  exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static bool run_line(unsigned number, char *line) {
+  char *comment = strchr(line, '#');
+  if (comment != NULL) {
+    *comment = '\0';
+  }
+
+  char when[24], event[16];
+  int consumed = 0;
+  if (sscanf(line, " %23s %15s %n", when, event, &consumed) < 2) {
+    return true; // empty
+  }
+  char *args = line + consumed;
+
+  int64_t ns;
+  if (!parse_time(when, &ns)) {
+    return false;
+  }
+  virtual_clock_advance(ns);
+
+  int a, b;
+  char period[24], width[24];
+  int64_t period_ns, width_ns;
+  if (strcmp(event, "sensor") == 0 && sscanf(args, "%d", &a) == 1) {
+    set_pin(CONFIG_SENSOR_IR, a);
+  } else if (strcmp(event, "pin") == 0 && sscanf(args, "%d %d", &a, &b) == 2) {
+    set_pin(a, b);
+  } else if (strcmp(event, "pulses") == 0 &&
+             sscanf(args, "%d %23s %23s", &a, period, width) == 3 && a > 0 &&
+             event_script_duration(period, &period_ns) &&
+             event_script_duration(width, &width_ns)) {
+    pulses(CONFIG_SENSOR_IR, a, period_ns, width_ns);
+  } else if (strcmp(event, "turn") == 0 &&
+             (b = sscanf(args, "%d %23s", &a, period)) >= 1 &&
+             (b == 1 || event_script_duration(period, &period_ns))) {
+    for (int i = 0; i < abs(a); i++) {
+      if (b == 2 && i > 0) {
+        virtual_clock_advance(virtual_clock_now_ns() + period_ns);
+      }
+      rotary_encoder_fake_send(RE_ET_CHANGED, a > 0 ? 1 : -1);
+      event_script_settle();
+    }
+  } else if (strcmp(event, "click") == 0) {
+    press(RE_ET_BTN_PRESSED);
+    press(RE_ET_BTN_RELEASED);
+    press(RE_ET_BTN_CLICKED);
+  } else if (strcmp(event, "long") == 0) {
+    press(RE_ET_BTN_PRESSED);
+    press(RE_ET_BTN_LONG_PRESSED);
+    press(RE_ET_BTN_RELEASED);
+  } else if (strcmp(event, "lcd") == 0) {
+    wait_screen();
+    printf("%" PRId64 "us\n", esp_timer_get_time());
+    hd44780_fake_dump(stdout);
+  } else if (strcmp(event, "expect") == 0 && sscanf(args, "%d", &a) == 1) {
+    char *text = args;
+    while (isdigit((unsigned char)*text)) {
+      text++;
+    }
+    while (*text == ' ') {
+      text++;
+    }
+    size_t len = strlen(text);
+    while (len > 0 && isspace((unsigned char)text[len - 1])) {
+      text[--len] = '\0';
+    }
+    expect(number, a, text);
+  } else if (strcmp(event, "quit") == 0) {
+    quit();
+  } else {
+    for (size_t i = 0; i < added_size; i++) {
+      if (strcmp(event, added[i].event) == 0) {
+        return added[i].handler(args);
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+static void script_task(void *args) {
+  char line[SCRIPT_LINE_SIZE];
+  unsigned number = 0;
+
+  event_script_settle();
+  while (fgets(line, sizeof(line), script) != NULL) {
+    number++;
+    if (!run_line(number, line)) {
+      failures++;
+      ESP_LOGE(TAG, "line %u: cannot run \"%s\"", number, line);
+    }
+  }
+  quit();
+}
+
+esp_err_t event_script_start(void) {
+  const char *path = getenv("PHOTOGATE_SCRIPT");
+
+  script = path != NULL ? fopen(path, "r") : stdin;
+  if (script == NULL) {
+    ESP_LOGE(TAG, "cannot open %s", path);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  BaseType_t created = xTaskCreate(script_task, "script", 4096, NULL,
+                                   tskIDLE_PRIORITY, NULL);
+  return created == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+}
@@ -0,0 +1,58 @@
+#ifndef __ENCODER_H__
+#define __ENCODER_H__
+
+#include <driver/gpio.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Host fake of encoder from esp-idf-lib. There are no pins to poll, the
+ * events come from the event script, which also drives the sensor and the
+ * virtual clock. rotary_encoder_init starts the script. */
+
+typedef enum {
+  RE_BTN_RELEASED = 0,
+  RE_BTN_PRESSED = 1,
+  RE_BTN_LONG_PRESSED = 2,
+} rotary_encoder_btn_state_t;
+
+typedef struct {
+  gpio_num_t pin_a, pin_b, pin_btn;
+  uint8_t code;
+  uint16_t store;
+  size_t index;
+  uint64_t btn_pressed_time_us;
+  rotary_encoder_btn_state_t btn_state;
+} rotary_encoder_t;
+
+typedef enum {
+  RE_ET_CHANGED = 0,
+  RE_ET_BTN_RELEASED,
+  RE_ET_BTN_PRESSED,
+  RE_ET_BTN_LONG_PRESSED,
+  RE_ET_BTN_CLICKED,
+} rotary_encoder_event_type_t;
+
+typedef struct {
+  rotary_encoder_event_type_t type;
+  rotary_encoder_t *sender;
+  int32_t diff;
+} rotary_encoder_event_t;
+
+esp_err_t rotary_encoder_init(QueueHandle_t queue);
+esp_err_t rotary_encoder_add(rotary_encoder_t *re);
+esp_err_t rotary_encoder_remove(rotary_encoder_t *re);
+esp_err_t rotary_encoder_enable_acceleration(rotary_encoder_t *re,
+                                             uint16_t coeff);
+esp_err_t rotary_encoder_disable_acceleration(rotary_encoder_t *re);
+
+// Fake only
+
+/**
+ * @brief Send an event of the encoder added last, as the real one would
+ */
+void rotary_encoder_fake_send(rotary_encoder_event_type_t type, int32_t diff);
+
+#endif // __ENCODER_H__
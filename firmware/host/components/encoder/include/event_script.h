@@ -0,0 +1,46 @@
+#ifndef __EVENT_SCRIPT_H__
+#define __EVENT_SCRIPT_H__
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Event script of the host build, see event_script.c for the lines it takes.
+ * The firmware can add its own events, a handler runs in the script task at
+ * the time of its line. */
+
+#define EVENT_SCRIPT_HANDLERS 8
+
+/**
+ * @param args Rest of the line after the event name
+ * @return false when the arguments are wrong, counted as a failure
+ */
+typedef bool (*event_script_handler_t)(char *args);
+
+/**
+ * @brief Start the task that plays the script of PHOTOGATE_SCRIPT, or of the
+ * standard input when it is not set
+ */
+esp_err_t event_script_start(void);
+
+/**
+ * @brief Add an event, before the script runs its first line
+ */
+esp_err_t event_script_add(const char *event, event_script_handler_t handler);
+
+/**
+ * @brief Duration of a script, in us unless it ends with ms or s
+ */
+bool event_script_duration(const char *text, int64_t *ns);
+
+/**
+ * @brief Let every task woken by the last event run before going on
+ */
+void event_script_settle(void);
+
+/**
+ * @brief Count a failure, the script exits with an error status
+ */
+void event_script_fail(void);
+
+#endif // __EVENT_SCRIPT_H__
@@ -0,0 +1,172 @@
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <virtual_clock.h>
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  bool active;
+  int64_t deadline; // ns
+  int64_t period;   // ns, 0 for one shot
+  struct esp_timer *next;
+};
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+static struct esp_timer *timers = NULL;
+static volatile int64_t now_ns = 0;
+
+int64_t virtual_clock_now_ns(void) { return now_ns; }
+
+int64_t esp_timer_get_time(void) { return now_ns / 1000; }
+
+// Earliest armed timer, the first created wins a tie
+static struct esp_timer *next_due(void) {
+  struct esp_timer *due = NULL;
+
+  for (struct esp_timer *t = timers; t != NULL; t = t->next) {
+    if (t->active && (due == NULL || t->deadline < due->deadline)) {
+      due = t;
+    }
+  }
+  return due;
+}
+
+int64_t virtual_clock_next_deadline_ns(void) {
+  portENTER_CRITICAL(&lock);
+  struct esp_timer *due = next_due();
+  int64_t deadline = due != NULL ? due->deadline : INT64_MAX;
+  portEXIT_CRITICAL(&lock);
+
+  return deadline;
+}
+
+void virtual_clock_advance(int64_t ns) {
+  for (;;) {
+    portENTER_CRITICAL(&lock);
+    struct esp_timer *due = next_due();
+    if (due == NULL || due->deadline > ns) {
+      if (ns > now_ns) {
+        now_ns = ns;
+      }
+      portEXIT_CRITICAL(&lock);
+      return;
+    }
+
+    now_ns = due->deadline;
+    if (due->period > 0) {
+      due->deadline += due->period;
+    } else {
+      due->active = false;
+    }
+    esp_timer_cb_t callback = due->callback;
+    void *arg = due->arg;
+    portEXIT_CRITICAL(&lock);
+
+    callback(arg);
+  }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t *out_handle) {
+  if (create_args == NULL || create_args->callback == NULL ||
+      out_handle == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  struct esp_timer *timer = calloc(1, sizeof(struct esp_timer));
+  if (timer == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  timer->callback = create_args->callback;
+  timer->arg = create_args->arg;
+  timer->name = create_args->name;
+
+  // Appended, so the creation order breaks ties between deadlines
+  portENTER_CRITICAL(&lock);
+  struct esp_timer **tail = &timers;
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+  *tail = timer;
+  portEXIT_CRITICAL(&lock);
+
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+static esp_err_t arm(esp_timer_handle_t timer, uint64_t after_us,
+                     bool periodic) {
+  if (timer == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = ESP_OK;
+  portENTER_CRITICAL(&lock);
+  if (timer->active) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    timer->active = true;
+    timer->period = periodic ? (int64_t)after_us * 1000 : 0;
+    timer->deadline = now_ns + (int64_t)after_us * 1000;
+  }
+  portEXIT_CRITICAL(&lock);
+
+  return err;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return arm(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  if (period == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return arm(timer, period, true);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = ESP_OK;
+  portENTER_CRITICAL(&lock);
+  if (!timer->active) {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  timer->active = false;
+  portEXIT_CRITICAL(&lock);
+
+  return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  if (timer == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  portENTER_CRITICAL(&lock);
+  if (timer->active) {
+    portEXIT_CRITICAL(&lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  for (struct esp_timer **t = &timers; *t != NULL; t = &(*t)->next) {
+    if (*t == timer) {
+      *t = timer->next;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&lock);
+
+  free(timer);
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+  return timer != NULL && timer->active;
+}
@@ -0,0 +1,47 @@
+#ifndef __VIRTUAL_CLOCK_H__
+#define __VIRTUAL_CLOCK_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/* Virtual clock of the host build. Time only moves when the event source
+ * calls virtual_clock_advance, so a script replays the same on every run no
+ * matter how loaded the Linux box is. */
+
+#define VIRTUAL_CPU_FREQ_MHZ 160
+
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ VIRTUAL_CPU_FREQ_MHZ
+#endif
+
+int64_t virtual_clock_now_ns(void);
+
+/**
+ * @brief Move the clock forward to ns, firing every timer due on the way in
+ * deadline order. A time in the past is ignored.
+ */
+void virtual_clock_advance(int64_t ns);
+
+/**
+ * @brief Deadline of the next armed timer, INT64_MAX when there is none
+ */
+int64_t virtual_clock_next_deadline_ns(void);
+
+// esp_cpu.h of the host build
+/* The cycles count the time of the host, not the virtual one. Handling an
+ * event takes no virtual time, the cycles are what still measure the work,
+ * so the latency histograms show how long the host took. */
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (esp_cpu_cycle_count_t)(((int64_t)now.tv_sec * 1000000000 +
+                                  now.tv_nsec) *
+                                 VIRTUAL_CPU_FREQ_MHZ / 1000);
+}
+
+static inline int esp_cpu_get_core_id(void) { return 0; }
+
+#endif // __VIRTUAL_CLOCK_H__
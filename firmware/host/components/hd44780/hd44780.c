@@ -0,0 +1,210 @@
+#include <hd44780.h>
+#include <string.h>
+
+#define DDRAM_SIZE 0x80
+
+#define CMD_CLEAR 0x01
+#define CMD_ENTRY_MODE 0x04
+#define CMD_DISPLAY_CTRL 0x08
+#define CMD_SHIFT 0x10
+#define CMD_FUNC_SET 0x20
+#define CMD_CGRAM_ADDR 0x40
+#define CMD_DDRAM_ADDR 0x80
+
+static const uint8_t line_addr[] = {0x00, 0x40, 0x14, 0x54};
+
+static char ddram[DDRAM_SIZE];
+static uint8_t address = 0;
+static uint8_t lines = 2;
+static bool display_on = false;
+static bool backlight = false;
+
+// The nibbles of the 4 bit bus, same writes as the real driver
+static esp_err_t write_nibble(const hd44780_t *lcd, uint8_t nibble, bool rs) {
+  uint8_t data = (((nibble >> 3) & 1) << lcd->pins.d7) |
+                 (((nibble >> 2) & 1) << lcd->pins.d6) |
+                 (((nibble >> 1) & 1) << lcd->pins.d5) |
+                 ((nibble & 1) << lcd->pins.d4);
+  if (rs) {
+    data |= 1 << lcd->pins.rs;
+  }
+  if (lcd->pins.bl != HD44780_NOT_USED && lcd->backlight) {
+    data |= 1 << lcd->pins.bl;
+  }
+
+  esp_err_t err = lcd->write_cb(lcd, data | (1 << lcd->pins.e));
+  if (err != ESP_OK) {
+    return err;
+  }
+  return lcd->write_cb(lcd, data);
+}
+
+static esp_err_t write_byte(const hd44780_t *lcd, uint8_t byte, bool rs) {
+  if (lcd->write_cb == NULL) {
+    return ESP_OK;
+  }
+
+  esp_err_t err = write_nibble(lcd, byte >> 4, rs);
+  if (err != ESP_OK) {
+    return err;
+  }
+  return write_nibble(lcd, byte, rs);
+}
+
+esp_err_t hd44780_init(const hd44780_t *lcd) {
+  if (lcd == NULL || lcd->lines == 0 || lcd->lines > sizeof(line_addr)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  lines = lcd->lines;
+  backlight = lcd->backlight;
+  memset(ddram, ' ', sizeof(ddram));
+  address = 0;
+  display_on = true;
+
+  esp_err_t err = write_byte(lcd, CMD_FUNC_SET | (lcd->lines > 1 ? 0x08 : 0),
+                             false);
+  if (err == ESP_OK) {
+    err = write_byte(lcd, CMD_DISPLAY_CTRL | 0x04, false);
+  }
+  if (err == ESP_OK) {
+    err = write_byte(lcd, CMD_ENTRY_MODE | 0x02, false);
+  }
+  if (err == ESP_OK) {
+    err = write_byte(lcd, CMD_CLEAR, false);
+  }
+  return err;
+}
+
+esp_err_t hd44780_control(const hd44780_t *lcd, bool on, bool cursor,
+                          bool cursor_blink) {
+  if (lcd == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  display_on = on;
+  return write_byte(lcd,
+                    CMD_DISPLAY_CTRL | (on ? 0x04 : 0) | (cursor ? 0x02 : 0) |
+                        (cursor_blink ? 0x01 : 0),
+                    false);
+}
+
+esp_err_t hd44780_clear(const hd44780_t *lcd) {
+  if (lcd == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(ddram, ' ', sizeof(ddram));
+  address = 0;
+  return write_byte(lcd, CMD_CLEAR, false);
+}
+
+esp_err_t hd44780_gotoxy(const hd44780_t *lcd, uint8_t col, uint8_t line) {
+  if (lcd == NULL || line >= lines) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  address = (line_addr[line] + col) % DDRAM_SIZE;
+  return write_byte(lcd, CMD_DDRAM_ADDR | address, false);
+}
+
+esp_err_t hd44780_putc(const hd44780_t *lcd, char c) {
+  if (lcd == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  ddram[address] = c;
+  address = (address + 1) % DDRAM_SIZE;
+  return write_byte(lcd, c, true);
+}
+
+esp_err_t hd44780_puts(const hd44780_t *lcd, const char *s) {
+  if (lcd == NULL || s == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  for (; *s != '\0'; s++) {
+    esp_err_t err = hd44780_putc(lcd, *s);
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t hd44780_switch_backlight(hd44780_t *lcd, bool on) {
+  if (lcd == NULL || lcd->pins.bl == HD44780_NOT_USED) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  lcd->backlight = on;
+  backlight = on;
+  return lcd->write_cb != NULL ? lcd->write_cb(lcd, on ? 1 << lcd->pins.bl : 0)
+                               : ESP_OK;
+}
+
+esp_err_t hd44780_upload_character(const hd44780_t *lcd, uint8_t num,
+                                   const uint8_t *data) {
+  if (lcd == NULL || data == NULL || num > 7) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  esp_err_t err = write_byte(lcd, CMD_CGRAM_ADDR | (num * 8), false);
+  for (uint8_t i = 0; i < 8 && err == ESP_OK; i++) {
+    err = write_byte(lcd, data[i], true);
+  }
+  if (err == ESP_OK) {
+    err = hd44780_gotoxy(lcd, 0, 0);
+  }
+  return err;
+}
+
+esp_err_t hd44780_scroll_left(const hd44780_t *lcd) {
+  return lcd != NULL ? write_byte(lcd, CMD_SHIFT | 0x08, false)
+                     : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t hd44780_scroll_right(const hd44780_t *lcd) {
+  return lcd != NULL ? write_byte(lcd, CMD_SHIFT | 0x0c, false)
+                     : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t hd44780_cursor_shift_left(const hd44780_t *lcd) {
+  if (lcd == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  address = (address + DDRAM_SIZE - 1) % DDRAM_SIZE;
+  return write_byte(lcd, CMD_SHIFT, false);
+}
+
+esp_err_t hd44780_cursor_shift_right(const hd44780_t *lcd) {
+  if (lcd == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  address = (address + 1) % DDRAM_SIZE;
+  return write_byte(lcd, CMD_SHIFT | 0x04, false);
+}
+
+void hd44780_fake_line(uint8_t line, char *text) {
+  memset(text, ' ', HD44780_FAKE_COLUMNS);
+  text[HD44780_FAKE_COLUMNS] = '\0';
+  if (line >= lines || !display_on) {
+    return;
+  }
+
+  for (uint8_t x = 0; x < HD44780_FAKE_COLUMNS; x++) {
+    char c = ddram[(line_addr[line] + x) % DDRAM_SIZE];
+    text[x] = (uint8_t)c < 8 ? '#' : c;
+  }
+}
+
+void hd44780_fake_dump(FILE *out) {
+  char text[HD44780_FAKE_COLUMNS + 1];
+  char border[HD44780_FAKE_COLUMNS + 1];
+
+  memset(border, '-', HD44780_FAKE_COLUMNS);
+  border[HD44780_FAKE_COLUMNS] = '\0';
+
+  fprintf(out, "+%s+%s\n", border, backlight ? "" : " (backlight off)");
+  for (uint8_t line = 0; line < lines; line++) {
+    hd44780_fake_line(line, text);
+    fprintf(out, "|%s|\n", text);
+  }
+  fprintf(out, "+%s+\n", border);
+  fflush(out);
+}
@@ -0,0 +1,71 @@
+#ifndef __HD44780_H__
+#define __HD44780_H__
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Host fake of hd44780 from esp-idf-lib. The controller is a DDRAM in memory
+ * that a script can read back, and every command still goes through write_cb
+ * as the same nibbles the real driver sends, so the bus code runs too. */
+
+#define HD44780_NOT_USED 0xff
+#define HD44780_FAKE_COLUMNS 20
+
+typedef enum {
+  HD44780_FONT_5X8,
+  HD44780_FONT_5X10,
+} hd44780_font_t;
+
+typedef struct hd44780 hd44780_t;
+
+typedef esp_err_t (*hd44780_write_cb_t)(const hd44780_t *lcd, uint8_t data);
+
+struct hd44780 {
+  hd44780_write_cb_t write_cb;
+  struct {
+    uint8_t rs;
+    uint8_t e;
+    uint8_t d4;
+    uint8_t d5;
+    uint8_t d6;
+    uint8_t d7;
+    uint8_t bl;
+  } pins;
+  hd44780_font_t font;
+  uint8_t lines;
+  bool backlight;
+};
+
+esp_err_t hd44780_init(const hd44780_t *lcd);
+esp_err_t hd44780_control(const hd44780_t *lcd, bool on, bool cursor,
+                          bool cursor_blink);
+esp_err_t hd44780_clear(const hd44780_t *lcd);
+esp_err_t hd44780_gotoxy(const hd44780_t *lcd, uint8_t col, uint8_t line);
+esp_err_t hd44780_putc(const hd44780_t *lcd, char c);
+esp_err_t hd44780_puts(const hd44780_t *lcd, const char *s);
+esp_err_t hd44780_switch_backlight(hd44780_t *lcd, bool on);
+esp_err_t hd44780_upload_character(const hd44780_t *lcd, uint8_t num,
+                                   const uint8_t *data);
+esp_err_t hd44780_scroll_left(const hd44780_t *lcd);
+esp_err_t hd44780_scroll_right(const hd44780_t *lcd);
+esp_err_t hd44780_cursor_shift_left(const hd44780_t *lcd);
+esp_err_t hd44780_cursor_shift_right(const hd44780_t *lcd);
+
+// Fake only
+
+/**
+ * @brief Text of a line as shown, custom characters read as '#'
+ *
+ * @param text At least HD44780_FAKE_COLUMNS + 1 chars
+ */
+void hd44780_fake_line(uint8_t line, char *text);
+
+/**
+ * @brief Print the screen in a frame, one line of text per display line
+ */
+void hd44780_fake_dump(FILE *out);
+
+#endif // __HD44780_H__
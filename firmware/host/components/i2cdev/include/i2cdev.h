@@ -0,0 +1,79 @@
+#ifndef __I2CDEV_H__
+#define __I2CDEV_H__
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Host fake of i2cdev from esp-idf-lib. There is no bus, a write only counts
+ * the transaction and its bytes so the display traffic can be profiled. */
+
+typedef int i2c_port_t;
+
+typedef struct {
+  int mode;
+  int sda_io_num;
+  int scl_io_num;
+  bool sda_pullup_en;
+  bool scl_pullup_en;
+  struct {
+    uint32_t clk_speed;
+  } master;
+  uint32_t clk_flags;
+} i2c_config_t;
+
+typedef struct {
+  i2c_port_t port;
+  i2c_config_t cfg;
+  uint8_t addr;
+  SemaphoreHandle_t mutex;
+  uint32_t timeout_ticks;
+} i2c_dev_t;
+
+typedef struct {
+  uint32_t transactions;
+  uint32_t bytes;
+} i2c_dev_fake_stats_t;
+
+#define I2C_DEV_TAKE_MUTEX(dev)                                                \
+  do {                                                                         \
+    esp_err_t __ = i2c_dev_take_mutex(dev);                                    \
+    if (__ != ESP_OK)                                                          \
+      return __;                                                               \
+  } while (0)
+
+#define I2C_DEV_GIVE_MUTEX(dev)                                                \
+  do {                                                                         \
+    esp_err_t __ = i2c_dev_give_mutex(dev);                                    \
+    if (__ != ESP_OK)                                                          \
+      return __;                                                               \
+  } while (0)
+
+#define I2C_DEV_CHECK(dev, X)                                                  \
+  do {                                                                         \
+    esp_err_t ___ = X;                                                         \
+    if (___ != ESP_OK) {                                                       \
+      I2C_DEV_GIVE_MUTEX(dev);                                                 \
+      return ___;                                                              \
+    }                                                                          \
+  } while (0)
+
+esp_err_t i2cdev_init(void);
+esp_err_t i2cdev_done(void);
+esp_err_t i2c_dev_create_mutex(i2c_dev_t *dev);
+esp_err_t i2c_dev_delete_mutex(i2c_dev_t *dev);
+esp_err_t i2c_dev_take_mutex(i2c_dev_t *dev);
+esp_err_t i2c_dev_give_mutex(i2c_dev_t *dev);
+esp_err_t i2c_dev_read(const i2c_dev_t *dev, const void *out_data,
+                       size_t out_size, void *in_data, size_t in_size);
+esp_err_t i2c_dev_write(const i2c_dev_t *dev, const void *out_reg,
+                        size_t out_reg_size, const void *out_data,
+                        size_t out_size);
+
+// Fake only
+
+i2c_dev_fake_stats_t i2c_dev_fake_stats(void);
+
+#endif // __I2CDEV_H__
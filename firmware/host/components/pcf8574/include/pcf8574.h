@@ -0,0 +1,17 @@
+#ifndef __PCF8574_H__
+#define __PCF8574_H__
+
+#include <esp_err.h>
+#include <i2cdev.h>
+#include <stdint.h>
+
+/* Host fake of pcf8574 from esp-idf-lib, the port is a byte over the fake
+ * i2cdev. */
+
+esp_err_t pcf8574_init_desc(i2c_dev_t *dev, uint8_t addr, i2c_port_t port,
+                            int sda_gpio, int scl_gpio);
+esp_err_t pcf8574_free_desc(i2c_dev_t *dev);
+esp_err_t pcf8574_port_read(i2c_dev_t *dev, uint8_t *val);
+esp_err_t pcf8574_port_write(i2c_dev_t *dev, uint8_t value);
+
+#endif // __PCF8574_H__
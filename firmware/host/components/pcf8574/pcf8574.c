@@ -0,0 +1,33 @@
+#include <pcf8574.h>
+#include <string.h>
+
+esp_err_t pcf8574_init_desc(i2c_dev_t *dev, uint8_t addr, i2c_port_t port,
+                            int sda_gpio, int scl_gpio) {
+  if (dev == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  memset(dev, 0, sizeof(i2c_dev_t));
+  dev->port = port;
+  dev->addr = addr;
+  dev->cfg.sda_io_num = sda_gpio;
+  dev->cfg.scl_io_num = scl_gpio;
+  dev->cfg.master.clk_speed = 100000;
+  return i2c_dev_create_mutex(dev);
+}
+
+esp_err_t pcf8574_free_desc(i2c_dev_t *dev) { return i2c_dev_delete_mutex(dev); }
+
+esp_err_t pcf8574_port_read(i2c_dev_t *dev, uint8_t *val) {
+  if (dev == NULL || val == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return i2c_dev_read(dev, NULL, 0, val, 1);
+}
+
+esp_err_t pcf8574_port_write(i2c_dev_t *dev, uint8_t value) {
+  if (dev == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return i2c_dev_write(dev, NULL, 0, &value, 1);
+}
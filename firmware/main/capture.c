@@ -0,0 +1,516 @@
+#include <capture.h>
+#include <driver/gpio.h>
+#include <driver/mcpwm_cap.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <gate.h>
+#include <latency.h>
+#include <sdkconfig.h>
+#include <stdatomic.h>
+#include <stream.h>
+#include <string.h>
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
+#endif
+
+#if CONFIG_EDGE_CAPTURE
+#define RING_SIZE CONFIG_EDGE_RING_SIZE
+#else
+#define RING_SIZE 1 // never written, the drains find it empty
+#endif
+
+static edge_event_t ring_buffer[RING_SIZE];
+
+static edge_ring_t ring = {
+    .buffer = ring_buffer,
+    .mask = RING_SIZE - 1,
+};
+
+_Static_assert((RING_SIZE & (RING_SIZE - 1)) == 0,
+               "EDGE_RING_SIZE must be a power of two");
+
+/**
+ * @brief Write one event into the ring, called only by the producer
+ *
+ * @return false if the ring was full and the event was dropped
+ */
+bool IRAM_ATTR edge_ring_push(edge_ring_t *ring, const edge_event_t *event) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (head - tail > ring->mask) {
+    atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+    return false;
+  }
+
+  ring->buffer[head & ring->mask] = *event;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+/**
+ * @brief Read up to max events from the ring, called only by the consumer
+ *
+ * @return Number of events copied
+ */
+size_t edge_ring_pop_batch(edge_ring_t *ring, edge_event_t *events,
+                           size_t max) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  size_t available = head - tail;
+  size_t n = available < max ? available : max;
+
+  for (size_t i = 0; i < n; i++) {
+    events[i] = ring->buffer[(tail + i) & ring->mask];
+  }
+
+  atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+  return n;
+}
+
+/* Only safe while the producer is disarmed. */
+void edge_ring_reset(edge_ring_t *ring) {
+  atomic_store(&ring->head, 0);
+  atomic_store(&ring->tail, 0);
+  atomic_store(&ring->overruns, 0);
+}
+
+#if CONFIG_EDGE_CAPTURE
+
+static const char *TAG = "capture";
+
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool capture_armed = false;
+static volatile bool capture_rising = false;
+static volatile bool capture_falling = false;
+static volatile bool capture_all = false;
+static volatile uint32_t capture_count = 0;
+static volatile int64_t capture_glitch = 0;
+static volatile int64_t capture_min_interval = 0;
+static volatile int64_t capture_last = 0;
+static volatile bool capture_kept = false; // an edge was kept since the start
+static volatile uint32_t rejected = 0;
+
+// last edge, it waits for the next one while a glitch filter is set
+static edge_event_t held;
+static bool holding = false;
+
+/* Spacing check of the edges, the first edge of a run is always kept. */
+static inline bool IRAM_ATTR capture_reject(int64_t time) {
+  if (capture_kept && time - capture_last < capture_min_interval) {
+    rejected++;
+    return true;
+  }
+  capture_kept = true;
+  capture_last = time;
+  return false;
+}
+
+/* Counts and stores an edge that passed the glitch filter, with capture_lock
+ * held. */
+static void IRAM_ATTR capture_keep(const edge_event_t *edge,
+                                   BaseType_t *high_task_wakeup) {
+  edge_event_t event = *edge;
+
+  event.counted = event.rising ? capture_rising : capture_falling;
+  if (!event.counted && !capture_all) {
+    return;
+  }
+  if (capture_reject(event.time)) {
+    return;
+  }
+
+  event.count = event.counted ? ++capture_count : capture_count;
+  edge_ring_push(&ring, &event);
+  if (event.counted) {
+    gate_edge_from_isr(0, event.count, event.time, high_task_wakeup);
+  }
+}
+
+/* The glitch filter of the PCNT in software: an edge is held until the next
+ * one, and a pulse narrower than the filter drops both of its edges. */
+static void IRAM_ATTR capture_edge(int64_t time, bool rising,
+                                   BaseType_t *high_task_wakeup) {
+  edge_event_t edge = {.time = time, .rising = rising};
+
+  portENTER_CRITICAL_ISR(&capture_lock);
+  if (holding && time - held.time < capture_glitch) {
+    holding = false;
+  } else {
+    if (holding) {
+      capture_keep(&held, high_task_wakeup);
+    }
+    held = edge;
+    holding = capture_glitch > 0;
+    if (!holding) {
+      capture_keep(&edge, high_task_wakeup);
+    }
+  }
+  portEXIT_CRITICAL_ISR(&capture_lock);
+}
+
+/* The held edge is kept once it is older than the glitch filter, or once the
+ * capture is stopped and no edge can follow it. From the task that drains. */
+static void capture_settle(void) {
+  BaseType_t high_task_wakeup = pdFALSE;
+  int64_t now = esp_timer_get_time() * 1000;
+
+  portENTER_CRITICAL(&capture_lock);
+  if (holding && (!capture_armed || now - held.time >= capture_glitch)) {
+    holding = false;
+    capture_keep(&held, &high_task_wakeup);
+  }
+  portEXIT_CRITICAL(&capture_lock);
+
+  if (high_task_wakeup == pdTRUE) {
+    taskYIELD();
+  }
+}
+
+/* Every setting of the run, before the capture is armed. */
+static void capture_setup(const experiment_config_t *config) {
+  capture_rising = config->rising == PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+  capture_falling = config->falling == PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+  capture_all = config->all_edges;
+  capture_count = 0;
+  capture_glitch = config->filter.max_glitch_ns;
+  capture_min_interval = config->min_interval_ns;
+  capture_kept = false;
+  rejected = 0;
+  holding = false;
+  edge_ring_reset(&ring);
+}
+
+#if CONFIG_CAPTURE_BACKEND_MCPWM
+
+/* Good example of the MCPWM capture:
+ * https://github.com/espressif/esp-idf/tree/v5.1.2/examples/peripherals/mcpwm/mcpwm_capture_hc_sr04
+ */
+
+static mcpwm_cap_timer_handle_t cap_timer = NULL;
+static mcpwm_cap_channel_handle_t cap_chan = NULL;
+static uint32_t cap_resolution_mhz;
+
+// last latched edge, used to extend the 32 bits capture counter
+static bool cap_synced = false;
+static uint32_t cap_last_value;
+static int64_t cap_last_ticks;
+static int64_t cap_last_esp_time;
+static int64_t cap_origin;
+
+/* The capture counter wraps every 2^32 ticks (53s at 80MHz), so the number of
+ * wraps between two edges is recovered from the coarse esp_timer. */
+static int64_t IRAM_ATTR extend_ticks(uint32_t value, int64_t esp_time) {
+  if (!cap_synced) {
+    cap_synced = true;
+    cap_last_value = value;
+    cap_last_ticks = 0;
+    cap_last_esp_time = esp_time;
+    cap_origin = esp_time * 1000;
+    return 0;
+  }
+
+  uint32_t delta = value - cap_last_value;
+  int64_t coarse = (esp_time - cap_last_esp_time) * cap_resolution_mhz;
+  int64_t wraps = (coarse - delta + (1LL << 31)) >> 32;
+  if (wraps < 0) {
+    wraps = 0;
+  }
+
+  cap_last_ticks += delta + (wraps << 32);
+  cap_last_value = value;
+  cap_last_esp_time = esp_time;
+  return cap_last_ticks;
+}
+
+static bool IRAM_ATTR capture_isr(mcpwm_cap_channel_handle_t cap_chan,
+                                  const mcpwm_capture_event_data_t *edata,
+                                  void *user_data) {
+  BaseType_t high_task_wakeup = pdFALSE;
+  int64_t ticks = extend_ticks(edata->cap_value, esp_timer_get_time());
+
+  capture_edge(cap_origin + ticks * 1000 / cap_resolution_mhz,
+               edata->cap_edge == MCPWM_CAP_EDGE_POS, &high_task_wakeup);
+  return high_task_wakeup == pdTRUE;
+}
+
+esp_err_t capture_init(void) {
+  uint32_t resolution;
+
+  mcpwm_capture_timer_config_t timer_config = {
+      .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+      .group_id = 0,
+  };
+  ESP_ERROR_CHECK(mcpwm_new_capture_timer(&timer_config, &cap_timer));
+
+  mcpwm_capture_channel_config_t chan_config = {
+      .gpio_num = CONFIG_SENSOR_IR,
+      .prescale = 1,
+      .flags.pos_edge = true,
+      .flags.neg_edge = true,
+      .flags.keep_io_conf_at_exit = true,
+  };
+  ESP_ERROR_CHECK(
+      mcpwm_new_capture_channel(cap_timer, &chan_config, &cap_chan));
+
+  mcpwm_capture_event_callbacks_t callbacks = {
+      .on_cap = capture_isr,
+  };
+  ESP_ERROR_CHECK(
+      mcpwm_capture_channel_register_event_callbacks(cap_chan, &callbacks,
+                                                     NULL));
+
+  ESP_ERROR_CHECK(mcpwm_capture_timer_enable(cap_timer));
+  ESP_ERROR_CHECK(mcpwm_capture_timer_start(cap_timer));
+  ESP_ERROR_CHECK(mcpwm_capture_timer_get_resolution(cap_timer, &resolution));
+  cap_resolution_mhz = resolution / 1000000;
+
+  ESP_LOGI(TAG, "MCPWM capture ready at %" PRIu32 "MHz, ring of %d events",
+           cap_resolution_mhz, CONFIG_EDGE_RING_SIZE);
+  return ESP_OK;
+}
+
+/**
+ * @brief Arm the edge capture with the same edges that PCNT counts
+ *
+ * With all_edges the other edges are kept too, with the count of the last
+ * counted edge.
+ *
+ * @param config Experiment that will be timed
+ */
+void capture_start(const experiment_config_t *config) {
+  capture_stop();
+
+  capture_setup(config);
+  cap_synced = false;
+
+  capture_armed = true;
+  mcpwm_capture_channel_enable(cap_chan);
+}
+
+void capture_stop(void) {
+  // disable fails if the channel is already disabled, and that is fine
+  mcpwm_capture_channel_disable(cap_chan);
+  capture_armed = false;
+}
+
+#else
+
+/* The pin interrupts on one edge at a time, the other one is armed in the
+ * interrupt, so the direction is the edge that fired and not a level read
+ * after the latency. gpio_get_level and gpio_set_intr_type are not in IRAM,
+ * the interrupt goes to the registers. */
+static volatile bool capture_next_rising = true;
+
+#if CONFIG_IDF_TARGET_LINUX
+static inline int sensor_level(void) {
+  return gpio_get_level(CONFIG_SENSOR_IR);
+}
+
+static inline void sensor_arm(bool rising) {
+  gpio_set_intr_type(CONFIG_SENSOR_IR,
+                     rising ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE);
+}
+
+// the fake calls the interrupt on each edge, nothing stays pending
+static inline void sensor_clear(void) {}
+#else
+static inline int IRAM_ATTR sensor_level(void) {
+  return gpio_ll_get_level(&GPIO, CONFIG_SENSOR_IR);
+}
+
+static inline void IRAM_ATTR sensor_arm(bool rising) {
+  gpio_ll_set_intr_type(&GPIO, CONFIG_SENSOR_IR,
+                        rising ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE);
+}
+
+static inline void IRAM_ATTR sensor_clear(void) {
+#if CONFIG_SENSOR_IR < 32
+  gpio_ll_clear_intr_status(&GPIO, BIT(CONFIG_SENSOR_IR));
+#else
+  gpio_ll_clear_intr_status_high(&GPIO, BIT(CONFIG_SENSOR_IR - 32));
+#endif
+}
+#endif
+
+static void IRAM_ATTR capture_isr(void *args) {
+  int64_t time = esp_timer_get_time() * 1000;
+  bool rising = capture_next_rising;
+  BaseType_t high_task_wakeup = pdFALSE;
+
+  capture_next_rising = !rising;
+  sensor_arm(!rising);
+  capture_edge(time, rising, &high_task_wakeup);
+
+  // a pulse shorter than the latency ended before its other edge was armed,
+  // both edges get the same time and a glitch filter drops them. When it
+  // ended after, the edge is pending too and would come back as a phantom
+  // pair, it is cleared before the first edge is armed again.
+  if (sensor_level() != rising) {
+    capture_next_rising = rising;
+    sensor_clear();
+    sensor_arm(rising);
+    capture_edge(time, !rising, &high_task_wakeup);
+  }
+
+  if (high_task_wakeup == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+esp_err_t capture_init(void) {
+  esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  // the service might be installed by another component
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    return err;
+  }
+
+  ESP_ERROR_CHECK(gpio_set_intr_type(CONFIG_SENSOR_IR, GPIO_INTR_POSEDGE));
+  ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_SENSOR_IR, capture_isr, NULL));
+  ESP_ERROR_CHECK(gpio_intr_disable(CONFIG_SENSOR_IR));
+
+  ESP_LOGI(TAG, "Edge capture ready, ring of %d events",
+           CONFIG_EDGE_RING_SIZE);
+  return ESP_OK;
+}
+
+/**
+ * @brief Arm the edge capture with the same edges that PCNT counts
+ *
+ * With all_edges the other edges are kept too, with the count of the last
+ * counted edge.
+ *
+ * @param config Experiment that will be timed
+ */
+void capture_start(const experiment_config_t *config) {
+  gpio_intr_disable(CONFIG_SENSOR_IR);
+
+  capture_setup(config);
+
+  // the next edge is the other level
+  capture_next_rising = sensor_level() == 0;
+  sensor_arm(capture_next_rising);
+  capture_armed = true;
+  gpio_intr_enable(CONFIG_SENSOR_IR);
+}
+
+void capture_stop(void) {
+  gpio_intr_disable(CONFIG_SENSOR_IR);
+  capture_armed = false;
+}
+
+#endif // CONFIG_CAPTURE_BACKEND_MCPWM
+
+uint32_t capture_rejected(void) { return rejected; }
+
+#else
+
+static void capture_settle(void) {}
+
+esp_err_t capture_init(void) { return ESP_OK; }
+
+void capture_start(const experiment_config_t *config) {}
+
+void capture_stop(void) {}
+
+uint32_t capture_rejected(void) { return 0; }
+
+#endif // CONFIG_EDGE_CAPTURE
+
+static size_t drain(edge_run_t *run, bool stream) {
+  edge_event_t batch[16];
+  size_t total = 0;
+  size_t n;
+
+  capture_settle();
+  while ((n = edge_ring_pop_batch(&ring, batch, 16)) > 0) {
+    if (stream) {
+      stream_edges(batch, n);
+      latency_drained(batch, n);
+    }
+    if (run->sink != NULL) {
+      run->sink(batch, n);
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (run->size < EDGE_RUN_SIZE) {
+        run->events[run->size++] = batch[i];
+      } else {
+        run->dropped++;
+      }
+    }
+    total += n;
+  }
+  if (stream) {
+    stream_flush();
+  }
+
+  return total;
+}
+
+/**
+ * @brief Move every event waiting in the ring to the run of the experiment
+ *
+ * Only from the experiment task, which is the writer of the stream.
+ *
+ * @param run Edges of the current run, events that do not fit are dropped
+ * @return Number of events read from the ring
+ */
+size_t capture_drain(edge_run_t *run) { return drain(run, true); }
+
+/**
+ * @brief Same as capture_drain, for a sample that is not streamed
+ */
+size_t capture_sample(edge_run_t *run) { return drain(run, false); }
+
+uint32_t capture_overruns(void) { return atomic_load(&ring.overruns); }
+
+/**
+ * @brief Search the edge with a given count in the run
+ *
+ * @return The edge or NULL if it was not captured
+ */
+const edge_event_t *capture_find_edge(const edge_run_t *run, uint32_t count) {
+  // without drops the edge is at its own position
+  if (count > 0 && count <= run->size && run->events[count - 1].counted &&
+      run->events[count - 1].count == count) {
+    return &run->events[count - 1];
+  }
+
+  for (size_t i = 0; i < run->size; i++) {
+    if (run->events[i].counted && run->events[i].count == count) {
+      return &run->events[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Time of the run between the edges of the watch points
+ *
+ * Those times come from the capture backend, when it latches the edges in
+ * hardware they do not have the latency of the PCNT interrupt. The difference
+ * is taken in nanoseconds and rounded once to microseconds. The GPIO backend
+ * stamps with esp_timer, so its times keep a resolution of one microsecond.
+ *
+ * @param run Edges of the run
+ * @param watchPoint Counts that start and stop the experiment
+ * @param timed Time of the run in microseconds, kept if an edge is not found
+ * @return true if both edges were in the run
+ */
+bool capture_latched_timed(const edge_run_t *run, const int32_t watchPoint[2],
+                           int64_t *timed) {
+  const edge_event_t *start = capture_find_edge(run, watchPoint[0]);
+  const edge_event_t *stop = capture_find_edge(run, watchPoint[1]);
+
+  if (start == NULL || stop == NULL) {
+    return false;
+  }
+
+  *timed = (stop->time - start->time + 500) / 1000;
+  return true;
+}
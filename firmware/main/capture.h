@@ -0,0 +1,79 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Edge Capture
+/* Every qualifying edge of the sensor is stamped in the ISR and written into a
+ * single-producer/single-consumer ring. The experiment task drains it in
+ * batches, so no FreeRTOS call is made per edge.
+ *
+ * The glitch filter of the run is applied as the PCNT does: each edge waits
+ * for the next one, and both edges of a pulse narrower than the filter are
+ * dropped. The last edge is kept by the drain once it is older than the
+ * filter; the writes to the ring are then serialized by a lock, so there is
+ * still one producer at a time. An edge closer than min_interval_ns to the
+ * last edge kept is only counted as rejected; the run of gate 0 then counts
+ * the kept edges, see gate_edge_from_isr(). */
+
+// a pendulum of 127 periods with both edges, a longer run keeps its first
+// edges and counts the others as dropped, its sink still takes every edge
+#define EDGE_RUN_SIZE 512
+
+typedef struct {
+  int64_t time;   // nanoseconds
+  uint32_t count; // PCNT count after the edge, counted since capture_start
+  bool rising;
+  bool counted; // false for the edges kept only with all_edges
+} edge_event_t;
+
+typedef struct {
+  edge_event_t *buffer;
+  uint32_t mask;
+  atomic_uint_fast32_t head; // only written by the producer (ISR)
+  atomic_uint_fast32_t tail; // only written by the consumer (task)
+  atomic_uint_fast32_t overruns;
+} edge_ring_t;
+
+// every batch of edges the drains take from the ring
+typedef void (*edge_sink_t)(const edge_event_t *events, size_t n);
+
+typedef struct {
+  edge_event_t events[EDGE_RUN_SIZE];
+  size_t size;
+  uint32_t dropped;
+  edge_sink_t sink; // NULL when only the run keeps the edges
+} edge_run_t;
+
+bool edge_ring_push(edge_ring_t *ring, const edge_event_t *event);
+
+size_t edge_ring_pop_batch(edge_ring_t *ring, edge_event_t *events,
+                           size_t max);
+
+void edge_ring_reset(edge_ring_t *ring);
+
+esp_err_t capture_init(void);
+
+void capture_start(const experiment_config_t *config);
+
+void capture_stop(void);
+
+size_t capture_drain(edge_run_t *run);
+
+size_t capture_sample(edge_run_t *run);
+
+uint32_t capture_overruns(void);
+
+uint32_t capture_rejected(void);
+
+const edge_event_t *capture_find_edge(const edge_run_t *run, uint32_t count);
+
+bool capture_latched_timed(const edge_run_t *run, const int32_t watchPoint[2],
+                           int64_t *timed);
+
+#endif // __CAPTURE_H__
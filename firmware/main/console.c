@@ -0,0 +1,399 @@
+#include <console.h>
+#include <sdkconfig.h>
+
+#if CONFIG_SERIAL_CONSOLE
+#include <capture.h>
+#include <ctype.h>
+#include <encoder.h>
+#include <errno.h>
+#include <esp_console.h>
+#include <esp_log.h>
+#include <filter.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <history.h>
+#include <inttypes.h>
+#include <latency.h>
+#include <stats.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timing.h>
+
+static const char *TAG = "console";
+
+static const char *experiment_names[] = {"pendulum", "spring", "energy"};
+static const char *energy_names[] = {"solid", "rire", "re", "ri"};
+static const char *mode_names[] = {"edges", "fit"};
+
+static portMUX_TYPE console_lock = portMUX_INITIALIZER_UNLOCKED;
+static int8_t attached = -1; // experiment open on the device
+static int8_t queued_kind = -1;
+static uint16_t queued_param;
+static uint32_t queued_runs = 0;
+
+static int find_name(const char *name, const char *names[], size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* A decimal number up to max, with nothing before or after it. */
+static bool parse_number(const char *text, uint32_t max, uint32_t *value) {
+  char *end;
+
+  errno = 0;
+  unsigned long number = strtoul(text, &end, 10);
+  if (!isdigit((unsigned char)*text) || *end != '\0' || errno != 0 ||
+      number > max) {
+    return false;
+  }
+  *value = number;
+  return true;
+}
+
+/* Wakes the experiment waiting for the encoder, the event itself is
+ * ignored by every stage. */
+static void wake_experiment(void) {
+  rotary_encoder_event_t e = {.type = RE_ET_BTN_PRESSED};
+
+  xQueueSend(qCommand, &e, 0);
+  if (tExperiment != NULL) {
+    xTaskNotify(tExperiment, EVENT_COMMAND, eSetBits);
+  }
+}
+
+static int cmd_run(int argc, char **argv) {
+  int kind, param;
+  uint32_t periods, runs = 1;
+
+  if (argc < 3 || argc > 4) {
+    printf("error,usage: run <pendulum|spring|energy> <periods|shape> "
+           "[runs]\n");
+    return 1;
+  }
+
+  kind = find_name(argv[1], experiment_names, 3);
+  if (kind < 0) {
+    printf("error,unknown experiment %s\n", argv[1]);
+    return 1;
+  }
+
+  if (kind == EXPERIMENT_ENERGY) {
+    param = find_name(argv[2], energy_names, 4);
+  } else {
+    bool valid = parse_number(argv[2], EXPERIMENT_MAX_PERIODS, &periods);
+    param = valid && periods >= 1 ? (int)periods : -1;
+  }
+  if (param < 0) {
+    printf("error,bad parameter %s\n", argv[2]);
+    return 1;
+  }
+
+  if (argc == 4) {
+    if (!parse_number(argv[3], UINT32_MAX, &runs) || runs < 1) {
+      printf("error,bad number of runs %s\n", argv[3]);
+      return 1;
+    }
+  }
+
+  portENTER_CRITICAL(&console_lock);
+  bool open = attached == kind;
+  if (open) {
+    queued_kind = kind;
+    queued_param = param;
+    queued_runs = runs;
+  }
+  portEXIT_CRITICAL(&console_lock);
+
+  if (!open) {
+    printf("error,open %s on the device first\n", experiment_names[kind]);
+    return 1;
+  }
+
+  wake_experiment();
+  printf("ok,%s,%d,%" PRIu32 "\n", experiment_names[kind], param, runs);
+  return 0;
+}
+
+static int cmd_stop(int argc, char **argv) {
+  portENTER_CRITICAL(&console_lock);
+  uint32_t left = queued_runs;
+  queued_runs = 0;
+  portEXIT_CRITICAL(&console_lock);
+
+  printf("ok,%" PRIu32 "\n", left);
+  return 0;
+}
+
+static int cmd_history(int argc, char **argv) {
+  size_t size = history_size();
+
+  if (argc != 2 || strcmp(argv[1], "dump") != 0) {
+    printf("error,usage: history dump\n");
+    return 1;
+  }
+
+  printf("history,index,kind,param,timed_us,mode,fit_error_ns\n");
+  for (size_t i = 0; i < size; i++) {
+    experiment_data_t data;
+    if (history_at(i, &data) && data.kind <= EXPERIMENT_ENERGY &&
+        data.mode <= RESULT_FIT) {
+      printf("history,%zu,%s,%u,%" PRId64 ",%s,%" PRIu32 "\n", i,
+             experiment_names[data.kind], data.param, data.timed,
+             mode_names[data.mode], data.fit_error_ns);
+    }
+  }
+  printf("ok,%zu\n", size);
+  return 0;
+}
+
+static int cmd_stats(int argc, char **argv) {
+  stats_entry_t entry;
+  size_t size = stats_size();
+
+  printf("stats,kind,param,mode,count,mean_us,sd_us,se_us,min_us,max_us\n");
+  for (size_t i = 0; i < size; i++) {
+    if (stats_get(i, &entry) && entry.kind <= EXPERIMENT_ENERGY &&
+        entry.mode <= RESULT_FIT) {
+      printf("stats,%s,%u,%s,%" PRIu32 ",%.1f,%.1f,%.1f,%" PRId64
+             ",%" PRId64 "\n",
+             experiment_names[entry.kind], entry.param,
+             mode_names[entry.mode], entry.count, entry.mean,
+             stats_deviation(&entry), stats_error(&entry), entry.min,
+             entry.max);
+    }
+  }
+  printf("ok,%zu\n", size);
+  return 0;
+}
+
+static int cmd_latency(int argc, char **argv) {
+  latency_histogram_t h;
+
+  if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+    latency_reset();
+    printf("ok\n");
+    return 0;
+  }
+  if (argc != 1) {
+    printf("error,usage: latency [reset]\n");
+    return 1;
+  }
+
+  printf("latency,stage,count,min_ns,p99_ns,max_ns,jitter_ns\n");
+  for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++) {
+    latency_snapshot(stage, &h);
+    printf("latency,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+           ",%" PRIu32 "\n",
+           latency_stage_label[stage], h.count, h.min,
+           latency_percentile(&h, 99), h.max, h.max - h.min);
+  }
+  printf("ok,%d,%d\n", TIMING_CORE, UI_CORE);
+  return 0;
+}
+
+static int cmd_stress(int argc, char **argv) {
+  long seconds;
+
+  if (argc != 2 || (seconds = strtol(argv[1], NULL, 10)) <= 0) {
+    printf("error,usage: stress <seconds>\n");
+    return 1;
+  }
+  if (timing_stress(seconds) != ESP_OK) {
+    printf("error,busy\n");
+    return 1;
+  }
+  printf("ok,%ld\n", seconds);
+  return 0;
+}
+
+static void print_filter(void) {
+  filter_settings_t settings;
+
+  filter_get(&settings);
+  printf("filter,glitch_ns,min_interval_us,rejected\n");
+  printf("filter,%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", settings.glitch_ns,
+         settings.min_interval_ns / 1000, capture_rejected());
+}
+
+static int cmd_filter(int argc, char **argv) {
+  filter_settings_t settings;
+  filter_sample_t sample;
+  esp_err_t err;
+
+  if (argc == 1) {
+    print_filter();
+    printf("ok\n");
+    return 0;
+  }
+
+  if (argc == 4 && strcmp(argv[1], "set") == 0) {
+    uint32_t interval_us;
+    if (!parse_number(argv[2], FILTER_MAX_GLITCH_NS, &settings.glitch_ns)) {
+      printf("error,glitch filter of 0 to %d ns\n", FILTER_MAX_GLITCH_NS);
+      return 1;
+    }
+    if (!parse_number(argv[3], FILTER_MAX_INTERVAL_US, &interval_us)) {
+      printf("error,interval of 0 to %d us\n", FILTER_MAX_INTERVAL_US);
+      return 1;
+    }
+    settings.min_interval_ns = interval_us * 1000;
+    ESP_ERROR_CHECK(filter_set(&settings));
+    print_filter();
+    printf("ok\n");
+    return 0;
+  }
+
+  int state = argc >= 3 && strcmp(argv[1], "calibrate") == 0
+                  ? find_name(argv[2], filter_state_names, FILTER_STATES)
+                  : -1;
+  long ms = argc == 4 ? strtol(argv[3], NULL, 10) : 1000;
+  if (state < 0 || argc > 4 || ms <= 0) {
+    printf("error,usage: filter [set <glitch ns> <interval us>|calibrate "
+           "<free|blocked> [ms]]\n");
+    return 1;
+  }
+
+  err = filter_calibrate(state, ms, &sample);
+  if (err != ESP_OK) {
+    printf("error,%s\n", err == ESP_ERR_INVALID_STATE
+                              ? "close the experiment first"
+                              : esp_err_to_name(err));
+    return 1;
+  }
+  printf("calibrate,state,edges,filtered,widest_ns\n");
+  printf("calibrate,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+         filter_state_names[state], sample.edges,
+         sample.edges > sample.counted ? sample.edges - sample.counted : 0,
+         sample.widest_ns);
+  print_filter();
+  printf("ok\n");
+  return 0;
+}
+
+esp_err_t console_init(void) {
+  esp_console_repl_t *repl = NULL;
+  esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+  esp_console_dev_uart_config_t uart_config =
+      ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+
+  repl_config.prompt = "photogate>";
+  ESP_ERROR_CHECK(esp_console_new_repl_uart(&uart_config, &repl_config, &repl));
+
+  const esp_console_cmd_t commands[] = {
+      {.command = "run",
+       .help = "Queue runs on the open experiment",
+       .hint = "<pendulum|spring|energy> <periods|solid|rire|re|ri> [runs]",
+       .func = &cmd_run},
+      {.command = "stop", .help = "Drop the queued runs", .func = &cmd_stop},
+      {.command = "history",
+       .help = "Print every result",
+       .hint = "dump",
+       .func = &cmd_history},
+      {.command = "stats",
+       .help = "Print the statistics of each configuration",
+       .func = &cmd_stats},
+      {.command = "latency",
+       .help = "Print or reset the latency of the stamps",
+       .hint = "[reset]",
+       .func = &cmd_latency},
+      {.command = "stress",
+       .help = "Redraw the screen on the UI core for a while",
+       .hint = "<seconds>",
+       .func = &cmd_stress},
+      {.command = "filter",
+       .help = "Print, set or calibrate the filter of the sensor",
+       .hint = "[set <glitch ns> <interval us>|calibrate <free|blocked> [ms]]",
+       .func = &cmd_filter},
+  };
+
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    ESP_ERROR_CHECK(esp_console_cmd_register(&commands[i]));
+  }
+  ESP_ERROR_CHECK(esp_console_register_help_command());
+
+  ESP_LOGI(TAG, "Serial commands ready");
+  return esp_console_start_repl(repl);
+}
+
+/**
+ * @brief The experiment is open on the device and takes runs
+ */
+void console_attach(experiment_kind_t kind) {
+  portENTER_CRITICAL(&console_lock);
+  attached = kind;
+  portEXIT_CRITICAL(&console_lock);
+}
+
+/**
+ * @brief The experiment was closed, the queued runs are dropped
+ */
+void console_detach(void) {
+  portENTER_CRITICAL(&console_lock);
+  attached = -1;
+  queued_runs = 0;
+  portEXIT_CRITICAL(&console_lock);
+}
+
+/**
+ * @brief Takes the next queued run of the experiment
+ *
+ * @param param Periods or energy_t of the run
+ * @return true if a run was queued
+ */
+bool console_take_run(experiment_kind_t kind, uint16_t *param) {
+  bool taken = false;
+
+  portENTER_CRITICAL(&console_lock);
+  if (queued_runs > 0 && queued_kind == (int8_t)kind) {
+    queued_runs--;
+    *param = queued_param;
+    taken = true;
+  }
+  portEXIT_CRITICAL(&console_lock);
+
+  return taken;
+}
+
+bool console_pending(experiment_kind_t kind) {
+  portENTER_CRITICAL(&console_lock);
+  bool pending = queued_runs > 0 && queued_kind == (int8_t)kind;
+  portEXIT_CRITICAL(&console_lock);
+
+  return pending;
+}
+
+void console_run_done(const experiment_data_t *data) {
+  portENTER_CRITICAL(&console_lock);
+  uint32_t left = queued_runs;
+  portEXIT_CRITICAL(&console_lock);
+
+  if (data->kind <= EXPERIMENT_ENERGY && data->mode <= RESULT_FIT) {
+    printf("result,%s,%u,%" PRId64 ",%s,%" PRIu32 ",%" PRIu32 "\n",
+           experiment_names[data->kind], data->param, data->timed,
+           mode_names[data->mode], data->fit_error_ns, left);
+  }
+}
+
+#else
+
+esp_err_t console_init(void) { return ESP_OK; }
+
+void console_attach(experiment_kind_t kind) {}
+
+void console_detach(void) {}
+
+bool console_take_run(experiment_kind_t kind, uint16_t *param) {
+  return false;
+}
+
+bool console_pending(experiment_kind_t kind) { return false; }
+
+void console_run_done(const experiment_data_t *data) {}
+
+#endif // CONFIG_SERIAL_CONSOLE
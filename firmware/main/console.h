@@ -0,0 +1,32 @@
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Console
+/* Serial commands on the console UART to drive the experiments without the
+ * encoder:
+ *   run pendulum 10 [runs]   run spring 5 [runs]   run energy ri [runs]
+ *   stop   history dump   stats   latency [reset]   stress <seconds>
+ *   filter   filter set <glitch ns> <interval us>
+ *   filter calibrate <free|blocked> [ms]
+ * A run goes to the experiment open on the device, that takes it as if its
+ * parameter was chosen and clicked; queued runs start as soon as the previous
+ * one is done. Every result is printed as a "result,..." line. */
+
+esp_err_t console_init(void);
+
+void console_attach(experiment_kind_t kind);
+
+void console_detach(void);
+
+bool console_take_run(experiment_kind_t kind, uint16_t *param);
+
+bool console_pending(experiment_kind_t kind);
+
+void console_run_done(const experiment_data_t *data);
+
+#endif // __CONSOLE_H__
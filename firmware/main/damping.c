@@ -0,0 +1,114 @@
+#include <damping.h>
+#include <esp_log.h>
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+
+static const char *TAG = "damping";
+
+/**
+ * @brief Starts the breakdown of a run between the watch points
+ */
+void damping_reset(damping_t *damping, const int32_t watchPoint[2]) {
+  memset(damping, 0, sizeof(*damping));
+  damping->last_count = watchPoint[1];
+  if (damping->last_count > DAMPING_MAX_PASSES) {
+    damping->last_count = DAMPING_MAX_PASSES;
+  }
+}
+
+void damping_add(damping_t *damping, const edge_event_t *edge) {
+  if (edge->count == 0 || edge->count > damping->last_count) {
+    return;
+  }
+
+  uint32_t pass = edge->count - 1;
+
+  if (edge->counted) {
+    if (damping->passes == 0) {
+      damping->origin = edge->time;
+    } else if (edge->count == damping->passes + 1) {
+      damping->half[pass - 1] = (edge->time - damping->rise) / 1000;
+
+      // every second pass closes a period
+      if (pass % 2 == 0 && damping->half[pass - 2] != 0) {
+        line_fit_add(&damping->drift, pass / 2,
+                     damping->half[pass - 2] + damping->half[pass - 1]);
+      }
+    }
+    damping->rise = edge->time;
+    damping->passes = edge->count;
+  } else if (edge->count == damping->passes &&
+             damping->transit[pass] == 0) {
+    uint32_t transit = (edge->time - damping->rise) / 1000;
+    if (transit > 0) {
+      damping->transit[pass] = transit;
+      line_fit_add(&damping->decay, (damping->rise - damping->origin) / 1e9,
+                   log(transit));
+    }
+  }
+}
+
+uint8_t damping_periods(const damping_t *damping) {
+  return damping->passes > 0 ? (damping->passes - 1) / 2 : 0;
+}
+
+/**
+ * @brief Half periods and transits of one period, the first is 1
+ */
+void damping_row(const damping_t *damping, uint8_t period,
+                 damping_row_t *row) {
+  uint32_t pass = 2 * (period - 1);
+
+  memset(row, 0, sizeof(*row));
+  if (period == 0 || period > damping_periods(damping)) {
+    return;
+  }
+
+  row->half[0] = damping->half[pass];
+  row->half[1] = damping->half[pass + 1];
+  row->transit[0] = damping->transit[pass];
+  row->transit[1] = damping->transit[pass + 1];
+  if (row->half[0] != 0 && row->half[1] != 0) {
+    row->period = row->half[0] + row->half[1];
+  }
+}
+
+/**
+ * @brief Damping coefficient of the amplitude, in 1/s
+ */
+bool damping_coefficient(const damping_t *damping, double *gamma,
+                         double *error) {
+  return line_fit_slope(&damping->decay, gamma, error);
+}
+
+/**
+ * @brief Change of the period from one period to the next, in us
+ */
+bool damping_drift(const damping_t *damping, double *drift, double *error) {
+  return line_fit_slope(&damping->drift, drift, error);
+}
+
+/**
+ * @brief Exports the breakdown to the log as CSV
+ */
+void damping_dump(const damping_t *damping) {
+  damping_row_t row;
+  double value, error;
+
+  ESP_LOGI(TAG, "period,period_us,half1_us,half2_us,transit1_us,transit2_us");
+  for (uint8_t period = 1; period <= damping_periods(damping); period++) {
+    damping_row(damping, period, &row);
+    ESP_LOGI(TAG,
+             "%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32,
+             period, row.period, row.half[0], row.half[1], row.transit[0],
+             row.transit[1]);
+  }
+
+  if (damping_coefficient(damping, &value, &error)) {
+    ESP_LOGI(TAG, "gamma: %.5f +- %.5f 1/s", value, error);
+  }
+  if (damping_drift(damping, &value, &error)) {
+    ESP_LOGI(TAG, "drift: %.2f +- %.2f us/period", value, error);
+  }
+}
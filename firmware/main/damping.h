@@ -0,0 +1,54 @@
+#ifndef __DAMPING_H__
+#define __DAMPING_H__
+
+#include <capture.h>
+#include <period_fit.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Damping
+/* Per period breakdown of a pendulum run with both edges captured. The
+ * counted edge starts a pass of the bob in the gate and the other edge ends
+ * it. The amplitude goes as 1/transit, so the damping coefficient is the
+ * slope of ln(transit) over time; the drift is the slope of the period over
+ * the period number. Both are fitted as the edges are drained. The breakdown
+ * and the fits stop at DAMPING_MAX_PERIODS, the later periods of a longer run
+ * are left out. */
+
+#define DAMPING_MAX_PERIODS 99
+#define DAMPING_MAX_PASSES (2 * DAMPING_MAX_PERIODS + 1)
+
+typedef struct {
+  uint32_t half[DAMPING_MAX_PASSES - 1]; // us between passes, 0 if unknown
+  uint32_t transit[DAMPING_MAX_PASSES];  // us inside the gate, 0 if unknown
+  uint32_t passes;                       // last pass started
+  uint32_t last_count;
+  int64_t origin;    // nanoseconds of the first pass
+  int64_t rise;      // nanoseconds of the start of the last pass
+  line_fit_t drift;  // period in us over the period number
+  line_fit_t decay;  // ln(transit) over seconds
+} damping_t;
+
+typedef struct {
+  uint32_t period;     // us, 0 if unknown
+  uint32_t half[2];    // us
+  uint32_t transit[2]; // us
+} damping_row_t;
+
+void damping_reset(damping_t *damping, const int32_t watchPoint[2]);
+
+void damping_add(damping_t *damping, const edge_event_t *edge);
+
+uint8_t damping_periods(const damping_t *damping);
+
+void damping_row(const damping_t *damping, uint8_t period, damping_row_t *row);
+
+bool damping_coefficient(const damping_t *damping, double *gamma,
+                         double *error);
+
+bool damping_drift(const damping_t *damping, double *drift, double *error);
+
+void damping_dump(const damping_t *damping);
+
+#endif // __DAMPING_H__
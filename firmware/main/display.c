@@ -0,0 +1,235 @@
+#include <display.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <lcd_bus.h>
+#include <string.h>
+#include <timing.h>
+
+#define UNKNOWN_POSITION 0xFF
+#define DISPLAY_QUEUE_SIZE 32
+
+static const char *TAG = "display";
+
+static QueueHandle_t qDisplay = NULL;
+
+// display_clear() of every writer, a screen was replaced when it moved
+static volatile uint32_t clears = 0;
+
+static const hd44780_t *display_lcd = NULL;
+
+static char shadow[CONFIG_VERTICAL_SIZE][CONFIG_HORIZONTAL_SIZE];
+static char screen[CONFIG_VERTICAL_SIZE][CONFIG_HORIZONTAL_SIZE];
+
+// address of the LCD, it moves by itself after each character
+static uint8_t lcd_x = UNKNOWN_POSITION, lcd_y = UNKNOWN_POSITION;
+
+static bool blink = false, screen_blink = false;
+static uint8_t blink_x = 0, blink_y = 0;
+
+static void send_command(const display_cmd_t *cmd) {
+  xQueueSend(qDisplay, cmd, portMAX_DELAY);
+}
+
+void display_clear(void) {
+  display_cmd_t cmd = {.op = DISPLAY_CLEAR};
+  clears++;
+  send_command(&cmd);
+}
+
+/**
+ * @brief Count of display_clear() calls, a writer that drew a screen knows
+ * it is still there while the count did not move
+ */
+uint32_t display_clears(void) { return clears; }
+
+void display_clear_line(uint8_t line) {
+  display_cmd_t cmd = {.op = DISPLAY_CLEAR_LINE, .y = line};
+  send_command(&cmd);
+}
+
+/* Text that pass the end of the line is cut. */
+void display_puts(uint8_t x, uint8_t y, const char *text) {
+  if (x >= CONFIG_HORIZONTAL_SIZE || y >= CONFIG_VERTICAL_SIZE) {
+    return;
+  }
+
+  display_cmd_t cmd = {.op = DISPLAY_PUTS, .x = x, .y = y};
+  strncpy(cmd.text, text, CONFIG_HORIZONTAL_SIZE - x);
+  send_command(&cmd);
+}
+
+/* The character 0 is a custom character, so it can not go by display_puts. */
+void display_putc(uint8_t x, uint8_t y, char c) {
+  if (x >= CONFIG_HORIZONTAL_SIZE || y >= CONFIG_VERTICAL_SIZE) {
+    return;
+  }
+
+  display_cmd_t cmd = {.op = DISPLAY_PUTC, .x = x, .y = y, .text = {c}};
+  send_command(&cmd);
+}
+
+/**
+ * @brief display_putc() and display_flush() that never wait, for the callbacks
+ * of the esp_timer task
+ *
+ * @return False when the queue has no room for both, nothing was sent
+ */
+bool display_try_putc(uint8_t x, uint8_t y, char c) {
+  if (x >= CONFIG_HORIZONTAL_SIZE || y >= CONFIG_VERTICAL_SIZE ||
+      uxQueueSpacesAvailable(qDisplay) < 2) {
+    return false;
+  }
+
+  display_cmd_t cmd = {.op = DISPLAY_PUTC, .x = x, .y = y, .text = {c}};
+  display_cmd_t flush = {.op = DISPLAY_FLUSH};
+  // another writer may take the room meanwhile, a flush of its own follows
+  return xQueueSend(qDisplay, &cmd, 0) == pdTRUE &&
+         xQueueSend(qDisplay, &flush, 0) == pdTRUE;
+}
+
+/**
+ * @brief Set the blinking cursor, applied on the next flush
+ *
+ * @param on Show the blinking cursor
+ * @param x Column of the cursor
+ * @param y Line of the cursor
+ */
+void display_cursor(bool on, uint8_t x, uint8_t y) {
+  display_cmd_t cmd = {.op = DISPLAY_CURSOR, .x = x, .y = y, .text = {on}};
+  send_command(&cmd);
+}
+
+/**
+ * @brief End of a frame, the task send the changes at the next frame slot
+ */
+void display_flush(void) {
+  display_cmd_t cmd = {.op = DISPLAY_FLUSH};
+  send_command(&cmd);
+}
+
+static void apply_command(const display_cmd_t *cmd) {
+  switch (cmd->op) {
+
+  case DISPLAY_PUTS:
+    for (uint8_t x = cmd->x;
+         x < CONFIG_HORIZONTAL_SIZE && cmd->text[x - cmd->x] != '\0'; x++) {
+      shadow[cmd->y][x] = cmd->text[x - cmd->x];
+    }
+    break;
+
+  case DISPLAY_PUTC:
+    shadow[cmd->y][cmd->x] = cmd->text[0];
+    break;
+
+  case DISPLAY_CLEAR:
+    memset(shadow, ' ', sizeof(shadow));
+    break;
+
+  case DISPLAY_CLEAR_LINE:
+    if (cmd->y < CONFIG_VERTICAL_SIZE) {
+      memset(shadow[cmd->y], ' ', CONFIG_HORIZONTAL_SIZE);
+    }
+    break;
+
+  case DISPLAY_CURSOR:
+    blink = cmd->text[0];
+    blink_x = cmd->x;
+    blink_y = cmd->y;
+    break;
+  }
+}
+
+/**
+ * @brief Send to the LCD the cells of the shadow that changed
+ */
+static void flush_shadow(void) {
+  lcd_bus_begin();
+
+  for (uint8_t y = 0; y < CONFIG_VERTICAL_SIZE; y++) {
+    for (uint8_t x = 0; x < CONFIG_HORIZONTAL_SIZE; x++) {
+      if (shadow[y][x] == screen[y][x]) {
+        continue;
+      }
+
+      if (lcd_x != x || lcd_y != y) {
+        hd44780_gotoxy(display_lcd, x, y);
+      }
+      hd44780_putc(display_lcd, shadow[y][x]);
+      screen[y][x] = shadow[y][x];
+
+      // the address after the last column is not the next line
+      lcd_x = x + 1 < CONFIG_HORIZONTAL_SIZE ? x + 1 : UNKNOWN_POSITION;
+      lcd_y = y;
+    }
+  }
+
+  if (blink != screen_blink) {
+    hd44780_control(display_lcd, true, false, blink);
+    screen_blink = blink;
+  }
+
+  if (blink && (lcd_x != blink_x || lcd_y != blink_y)) {
+    hd44780_gotoxy(display_lcd, blink_x, blink_y);
+    lcd_x = blink_x;
+    lcd_y = blink_y;
+  }
+
+  lcd_bus_end();
+}
+
+/* Owner of the LCD, a flush asked by a writer waits for the next frame slot
+ * and commands that arrive meanwhile go into the same frame. */
+static void display_task(void *args) {
+  const TickType_t frame = pdMS_TO_TICKS(1000 / CONFIG_DISPLAY_FPS);
+  TickType_t last_flush = xTaskGetTickCount() - frame;
+  bool pending = false;
+  display_cmd_t cmd;
+
+  while (true) {
+    TickType_t timeout = portMAX_DELAY;
+
+    if (pending) {
+      TickType_t elapsed = xTaskGetTickCount() - last_flush;
+      timeout = elapsed >= frame ? 0 : frame - elapsed;
+    }
+
+    if (xQueueReceive(qDisplay, &cmd, timeout) == pdTRUE) {
+      if (cmd.op == DISPLAY_FLUSH) {
+        pending = true;
+      } else {
+        apply_command(&cmd);
+      }
+    } else if (pending) {
+      flush_shadow();
+      last_flush = xTaskGetTickCount();
+      pending = false;
+    }
+  }
+}
+
+/**
+ * @brief Start the display task on a LCD that was just cleared by hd44780_init
+ *
+ * @param lcd LCD owned by the display task
+ */
+esp_err_t display_init(const hd44780_t *lcd) {
+  qDisplay = xQueueCreate(DISPLAY_QUEUE_SIZE, sizeof(display_cmd_t));
+  if (qDisplay == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  display_lcd = lcd;
+  memset(shadow, ' ', sizeof(shadow));
+  memset(screen, ' ', sizeof(screen));
+
+  if (xTaskCreatePinnedToCore(&display_task, "display", 2048, NULL, 2, NULL,
+                              UI_CORE) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG, "Shadow of %dx%d at %d FPS", CONFIG_HORIZONTAL_SIZE,
+           CONFIG_VERTICAL_SIZE, CONFIG_DISPLAY_FPS);
+  return ESP_OK;
+}
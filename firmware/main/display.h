@@ -0,0 +1,53 @@
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+#include <esp_err.h>
+#include <hd44780.h>
+#include <sdkconfig.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Display
+/* Only the display task talks to the LCD. Writers send compact draw commands
+ * through a queue, the task applies them to an in-RAM shadow of the LCD and,
+ * after a display_flush(), sends only the cells that changed at most
+ * CONFIG_DISPLAY_FPS times per second, jumping with gotoxy only when the next
+ * dirty cell is not the next address. A flush is sent to the expander as one
+ * I2C burst.
+ */
+
+typedef enum {
+  DISPLAY_PUTS = 0,
+  DISPLAY_PUTC,
+  DISPLAY_CLEAR,
+  DISPLAY_CLEAR_LINE,
+  DISPLAY_CURSOR,
+  DISPLAY_FLUSH,
+} display_op_t;
+
+typedef struct {
+  uint8_t op;
+  uint8_t x;
+  uint8_t y;
+  char text[CONFIG_HORIZONTAL_SIZE + 1];
+} display_cmd_t;
+
+esp_err_t display_init(const hd44780_t *lcd);
+
+void display_clear(void);
+
+uint32_t display_clears(void);
+
+void display_clear_line(uint8_t line);
+
+void display_puts(uint8_t x, uint8_t y, const char *text);
+
+void display_putc(uint8_t x, uint8_t y, char c);
+
+bool display_try_putc(uint8_t x, uint8_t y, char c);
+
+void display_cursor(bool on, uint8_t x, uint8_t y);
+
+void display_flush(void);
+
+#endif // __DISPLAY_H__
@@ -0,0 +1,187 @@
+#include <capture.h>
+#include <esp_log.h>
+#include <filter.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <gate.h>
+#include <inttypes.h>
+#include <nvs.h>
+#include <sdkconfig.h>
+
+static const char *TAG = "filter";
+
+const char *filter_state_names[FILTER_STATES] = {"free", "blocked"};
+
+static filter_settings_t settings = {
+    .glitch_ns = CONFIG_GLITCH_FILTER_NS,
+    .min_interval_ns = (uint32_t)CONFIG_EDGE_MIN_INTERVAL_US * 1000,
+};
+
+static void save_settings(void) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+
+  if (err == ESP_OK) {
+    nvs_set_blob(nvs, "filter", &settings, sizeof(settings));
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error (%s) saving the filter!", esp_err_to_name(err));
+  }
+}
+
+/**
+ * @brief Loads the calibrated filter, the defaults of the config otherwise
+ */
+esp_err_t filter_init(void) {
+  nvs_handle_t nvs;
+  filter_settings_t saved;
+  size_t size = sizeof(saved);
+
+  if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+    if (nvs_get_blob(nvs, "filter", &saved, &size) == ESP_OK &&
+        size == sizeof(saved)) {
+      settings = saved;
+    }
+    nvs_close(nvs);
+  }
+
+  ESP_LOGI(TAG, "Glitch filter %" PRIu32 "ns, minimum interval %" PRIu32 "us",
+           settings.glitch_ns, settings.min_interval_ns / 1000);
+  return ESP_OK;
+}
+
+void filter_apply(experiment_config_t *config) {
+  config->filter.max_glitch_ns = settings.glitch_ns;
+  config->min_interval_ns = settings.min_interval_ns;
+}
+
+void filter_get(filter_settings_t *current) { *current = settings; }
+
+esp_err_t filter_set(const filter_settings_t *chosen) {
+  if (chosen->glitch_ns > FILTER_MAX_GLITCH_NS ||
+      chosen->min_interval_ns > (uint32_t)FILTER_MAX_INTERVAL_US * 1000) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  settings = *chosen;
+  save_settings();
+  return ESP_OK;
+}
+
+#if CONFIG_EDGE_CAPTURE
+
+static filter_sample_t samples[FILTER_STATES];
+static bool sampled[FILTER_STATES];
+
+// Margin of the picked glitch filter over the widest noise, in percent
+#define FILTER_MARGIN_PERCENT 50
+
+/* Filter over the widest noise of the samples, up to the safe bound, and the
+ * interval that takes the noise the filter cannot. */
+static void pick(void) {
+  uint32_t safe = (uint32_t)CONFIG_FILTER_MIN_PULSE_US * 1000 / 2;
+  uint32_t bound = safe < FILTER_MAX_GLITCH_NS ? safe : FILTER_MAX_GLITCH_NS;
+  uint32_t widest = 0;
+  bool noise = false;
+
+  for (uint8_t i = 0; i < FILTER_STATES; i++) {
+    if (sampled[i] && samples[i].edges > 0) {
+      noise = true;
+      widest = samples[i].widest_ns > widest ? samples[i].widest_ns : widest;
+    }
+  }
+  if (!noise) {
+    return;
+  }
+
+  // an edge alone has no width, only the bound is sure to take it
+  uint64_t wanted =
+      widest > 0 ? (uint64_t)widest * (100 + FILTER_MARGIN_PERCENT) / 100
+                 : bound;
+  settings.glitch_ns = wanted < bound ? wanted : bound;
+  settings.min_interval_ns = 0;
+  // the filter drops the pulses narrower than itself
+  if (widest >= settings.glitch_ns) {
+    uint64_t interval = 2 * (uint64_t)widest;
+    settings.min_interval_ns = interval < safe ? interval : safe;
+  }
+  if (widest > safe) {
+    ESP_LOGW(TAG, "Pulses of %" PRIu32 "ns are as wide as the real ones",
+             widest);
+  }
+}
+
+#endif // CONFIG_EDGE_CAPTURE
+
+/**
+ * @brief Sample the steady sensor and pick the filter again
+ *
+ * Only while no experiment is open, it takes gate 0 and the capture. The
+ * edges are not streamed, the stream only carries runs of experiments.
+ *
+ * @param state The sensor is free or blocked for the whole sample
+ * @param ms Length of the sample
+ */
+esp_err_t filter_calibrate(filter_state_t state, uint32_t ms,
+                           filter_sample_t *sample) {
+#if CONFIG_EDGE_CAPTURE
+  static edge_run_t run;
+  experiment_config_t config = {
+      .rising = PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+      .falling = PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+      .filter = {.max_glitch_ns = settings.glitch_ns},
+      // never reached, the sample only counts
+      .watchPoint = {INT32_MAX - 1, INT32_MAX},
+      .all_edges = true,
+  };
+
+  if (state >= FILTER_STATES) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!gate_take(0, 0)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  ESP_ERROR_CHECK(gate_config(0, &config));
+  // the capture sees every pulse, the unit only the ones the filter let pass
+  experiment_config_t unfiltered = config;
+  unfiltered.filter.max_glitch_ns = 0;
+  capture_start(&unfiltered);
+  ESP_ERROR_CHECK(gate_start(0));
+
+  vTaskDelay(pdMS_TO_TICKS(ms));
+
+  capture_stop();
+  run.size = 0;
+  run.dropped = 0;
+  capture_sample(&run);
+  sample->counted = gate_count(0);
+  gate_release(0);
+  gate_give(0);
+
+  // the sensor is steady, every pair of edges is a spurious pulse
+  sample->edges = run.size + run.dropped;
+  sample->widest_ns = 0;
+  for (size_t i = 1; i < run.size; i += 2) {
+    uint32_t width = run.events[i].time - run.events[i - 1].time;
+    sample->widest_ns = width > sample->widest_ns ? width : sample->widest_ns;
+  }
+
+  samples[state] = *sample;
+  sampled[state] = true;
+  pick();
+  save_settings();
+
+  ESP_LOGI(TAG,
+           "%s: %" PRIu32 " edges, %" PRIu32 " rejected by the filter, widest "
+           "%" PRIu32 "ns",
+           filter_state_names[state], sample->edges,
+           sample->edges > sample->counted ? sample->edges - sample->counted
+                                           : 0,
+           sample->widest_ns);
+  return ESP_OK;
+#else
+  return ESP_ERR_NOT_SUPPORTED;
+#endif // CONFIG_EDGE_CAPTURE
+}
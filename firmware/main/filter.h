@@ -0,0 +1,58 @@
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdint.h>
+
+// Sensor filter
+/* Two layers keep the spurious edges of the sensor out of a run. The glitch
+ * filter of the PCNT drops pulses up to glitch_ns in hardware, before they
+ * cost a count, and the capture drops the same pulses in software. Wider noise
+ * passes it, so the capture drops the edges closer than min_interval_ns to the
+ * last edge it kept, and with an interval the run is counted and ended on
+ * those kept edges, not on the PCNT.
+ *
+ * filter_calibrate() samples the sensor while it is steady, free or blocked,
+ * so every edge seen is noise. It counts what the current glitch filter let
+ * through and picks a filter half again as wide as the widest noise, never
+ * over half of the shortest real pulse nor over the PCNT. When the noise is
+ * wider than that filter, it also picks a minimum interval. The choice is
+ * saved in NVS. */
+
+// 1023 cycles of the 80MHz APB clock, the widest glitch filter of the PCNT
+#define FILTER_MAX_GLITCH_NS 12787
+// 1s, the widest minimum interval, its nanoseconds still fit in 32 bits
+#define FILTER_MAX_INTERVAL_US 1000000
+
+typedef enum {
+  FILTER_FREE = 0,
+  FILTER_BLOCKED,
+  FILTER_STATES,
+} filter_state_t;
+
+typedef struct {
+  uint32_t glitch_ns;
+  uint32_t min_interval_ns;
+} filter_settings_t;
+
+typedef struct {
+  uint32_t edges;     // edges seen by the capture
+  uint32_t counted;   // edges the glitch filter let the PCNT count
+  uint32_t widest_ns; // widest spurious pulse
+} filter_sample_t;
+
+extern const char *filter_state_names[FILTER_STATES];
+
+esp_err_t filter_init(void);
+
+void filter_apply(experiment_config_t *config);
+
+void filter_get(filter_settings_t *settings);
+
+esp_err_t filter_set(const filter_settings_t *settings);
+
+esp_err_t filter_calibrate(filter_state_t state, uint32_t ms,
+                           filter_sample_t *sample);
+
+#endif // __FILTER_H__
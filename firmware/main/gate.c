@@ -0,0 +1,437 @@
+#include <driver/gpio.h>
+#include <driver/pulse_cnt.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+#include <gate.h>
+#include <inttypes.h>
+#include <sdkconfig.h>
+#include <string.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <virtual_clock.h>
+#else
+#include <esp_cpu.h>
+#endif
+
+static const char *TAG = "gate";
+
+typedef struct {
+  uint8_t id;
+  int pin;
+  pcnt_unit_handle_t unit;
+  pcnt_channel_handle_t chan;
+  int64_t laps;       // counts carried by the limit events
+  int64_t read;       // last count read by gate_count
+  int64_t targets[2]; // watch points of the run on the extended count
+  int points[2];      // watch points of the unit for the targets, 0 for none
+  bool edges;         // the run is decided by the edges the capture kept
+  int64_t kept;       // counted edges the capture kept since gate_start
+} gate_t;
+
+typedef struct {
+  uint32_t gates;
+  QueueHandle_t queue;
+  TaskHandle_t task;
+  uint32_t bits;
+} gate_subscriber_t;
+
+static const int gate_pins[GATE_COUNT] = {
+    CONFIG_SENSOR_IR,
+#if CONFIG_GATE_COUNT > 1
+    CONFIG_SENSOR_IR_1,
+#endif
+#if CONFIG_GATE_COUNT > 2
+    CONFIG_SENSOR_IR_2,
+#endif
+#if CONFIG_GATE_COUNT > 3
+    CONFIG_SENSOR_IR_3,
+#endif
+};
+
+static const pcnt_unit_config_t config_unit = {
+    .high_limit = GATE_HIGH_LIMIT,
+    .low_limit = GATE_LOW_LIMIT,
+};
+
+static gate_t gates[GATE_COUNT];
+static gate_subscriber_t subscribers[GATE_SUBSCRIBERS];
+static QueueHandle_t qGate = NULL;
+// binary, the task that gives a gate back is not always the one that took it
+static SemaphoreHandle_t owners[GATE_COUNT];
+static portMUX_TYPE gate_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void IRAM_ATTR send_stamp(pcnt_stamp_t *stamp, int64_t total,
+                                 BaseType_t *high_task_wakeup) {
+  stamp->watch_point = total;
+  xQueueSendFromISR(qGate, stamp, high_task_wakeup);
+}
+
+/* A little using example of the pcnt to take timed:
+ * https://github.com/MarcioBulla/Learning_ESP-IDF/blob/main/learning_pcnt/main/main.c
+ */
+static bool cronos(pcnt_unit_handle_t pcnt_unit,
+                   const pcnt_watch_event_data_t *edata, void *user_ctx) {
+  gate_t *gate = (gate_t *)user_ctx;
+  pcnt_stamp_t stamp = {
+      .time = esp_timer_get_time(),
+      .isr_cycles = esp_cpu_get_cycle_count(),
+      .isr_core = esp_cpu_get_core_id(),
+      .gate = gate->id,
+  };
+  int value = edata->watch_point_value;
+  BaseType_t high_task_wakeup = pdFALSE;
+
+  portENTER_CRITICAL_ISR(&gate_lock);
+  if (value == GATE_HIGH_LIMIT || value == GATE_LOW_LIMIT) {
+    // the unit is back to zero, the limit goes to the laps
+    gate->laps += value;
+    value = 0;
+  }
+  int64_t total = gate->laps + value;
+  bool target = total == gate->targets[0] || total == gate->targets[1];
+  portEXIT_CRITICAL_ISR(&gate_lock);
+
+  // the points of the targets are reached once per lap
+  if (!target) {
+    return false;
+  }
+
+  send_stamp(&stamp, total, &high_task_wakeup);
+  return (high_task_wakeup == pdTRUE);
+}
+
+/**
+ * @brief A counted edge that the capture kept, from its interrupt or from the
+ * task that settles the edge held by its glitch filter
+ *
+ * Only a gate configured with a minimum interval takes it, its targets are
+ * then counted on those edges and not on the unit.
+ *
+ * @param count Counted edges kept since capture_start
+ * @param time Nanoseconds of the edge, the stamp takes it
+ * @param high_task_wakeup Set when the stamp woke a higher priority task
+ */
+void IRAM_ATTR gate_edge_from_isr(uint8_t id, uint32_t count, int64_t time,
+                                  BaseType_t *high_task_wakeup) {
+  if (id >= GATE_COUNT) {
+    return;
+  }
+  gate_t *gate = &gates[id];
+  pcnt_stamp_t stamp = {
+      .time = time / 1000,
+      .isr_cycles = esp_cpu_get_cycle_count(),
+      .isr_core = esp_cpu_get_core_id(),
+      .gate = id,
+  };
+
+  portENTER_CRITICAL_ISR(&gate_lock);
+  bool target = false;
+  if (gate->edges) {
+    gate->kept = count;
+    target = count == gate->targets[0] || count == gate->targets[1];
+  }
+  portEXIT_CRITICAL_ISR(&gate_lock);
+
+  if (target) {
+    send_stamp(&stamp, count, high_task_wakeup);
+  }
+}
+
+esp_err_t gate_init(void) {
+  pcnt_event_callbacks_t callbacks = {
+      .on_reach = cronos,
+  };
+
+  qGate = xQueueCreate(GATE_QUEUE_SIZE, sizeof(pcnt_stamp_t));
+  if (qGate == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  for (uint8_t id = 0; id < GATE_COUNT; id++) {
+    gate_t *gate = &gates[id];
+    pcnt_chan_config_t config_chan = {
+        .edge_gpio_num = gate_pins[id],
+        .level_gpio_num = -1,
+    };
+
+    owners[id] = xSemaphoreCreateBinary();
+    if (owners[id] == NULL) {
+      return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(owners[id]);
+
+    gate->id = id;
+    gate->pin = gate_pins[id];
+    gate->targets[0] = gate->targets[1] = -1;
+
+    ESP_ERROR_CHECK(pcnt_new_unit(&config_unit, &gate->unit));
+    ESP_ERROR_CHECK(pcnt_new_channel(gate->unit, &config_chan, &gate->chan));
+    ESP_ERROR_CHECK(pcnt_channel_set_edge_action(
+        gate->chan, PCNT_CHANNEL_EDGE_ACTION_HOLD,
+        PCNT_CHANNEL_EDGE_ACTION_HOLD));
+    ESP_ERROR_CHECK(
+        pcnt_unit_register_event_callbacks(gate->unit, &callbacks, gate));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(gate->unit, GATE_HIGH_LIMIT));
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(gate->unit, GATE_LOW_LIMIT));
+    ESP_ERROR_CHECK(pcnt_unit_enable(gate->unit));
+
+    ESP_LOGI(TAG, "Gate %u on GPIO %d", id, gate->pin);
+  }
+  return ESP_OK;
+}
+
+/**
+ * @brief Hand the next stamp of the gates to their subscribers
+ *
+ * @param wait Ticks to wait for a stamp
+ * @return A stamp was handed
+ */
+bool gate_dispatch(TickType_t wait) {
+  pcnt_stamp_t stamp;
+  gate_subscriber_t current[GATE_SUBSCRIBERS];
+
+  if (xQueueReceive(qGate, &stamp, wait) != pdTRUE) {
+    return false;
+  }
+  latency_dequeued(&stamp);
+
+  portENTER_CRITICAL(&gate_lock);
+  memcpy(current, subscribers, sizeof(current));
+  portEXIT_CRITICAL(&gate_lock);
+
+  for (uint8_t i = 0; i < GATE_SUBSCRIBERS; i++) {
+    if (current[i].queue == NULL ||
+        (current[i].gates & GATE_BIT(stamp.gate)) == 0) {
+      continue;
+    }
+    xQueueSend(current[i].queue, &stamp, 0);
+    if (current[i].task != NULL) {
+      xTaskNotify(current[i].task, current[i].bits, eSetBits);
+    }
+  }
+  return true;
+}
+
+static void remove_points(gate_t *gate) {
+  for (uint8_t i = 0; i < 2; i++) {
+    if (gate->points[i] != 0) {
+      ESP_ERROR_CHECK(
+          pcnt_unit_remove_watch_point(gate->unit, gate->points[i]));
+      ESP_LOGI(TAG, "Remove watch point %u: %d", gate->id, gate->points[i]);
+    }
+    gate->points[i] = 0;
+  }
+}
+
+/**
+ * @brief Edge actions, glitch filter and watch points of a run, the gate
+ * counts once gate_start is called
+ *
+ * Watch points are counts of any size: the unit watches them modulo
+ * GATE_HIGH_LIMIT and cronos() keeps the lap that reaches them. With a
+ * minimum interval the unit watches nothing, the capture counts the edges it
+ * kept and reaches the targets through gate_edge_from_isr().
+ */
+esp_err_t gate_config(uint8_t id, const experiment_config_t *config) {
+  if (id >= GATE_COUNT || config->watchPoint[0] < 1 ||
+      config->watchPoint[1] < 1) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  gate_t *gate = &gates[id];
+
+  ESP_ERROR_CHECK(pcnt_unit_disable(gate->unit));
+
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(gate->chan, config->rising,
+                                               config->falling));
+
+  ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(gate->unit, &config->filter));
+
+  ESP_ERROR_CHECK(pcnt_unit_enable(gate->unit));
+
+  remove_points(gate);
+
+  bool edges = GATE_EDGES(id) && config->min_interval_ns > 0;
+
+  portENTER_CRITICAL(&gate_lock);
+  gate->targets[0] = config->watchPoint[0];
+  gate->targets[1] = config->watchPoint[1];
+  gate->edges = edges;
+  portEXIT_CRITICAL(&gate_lock);
+
+  for (uint8_t i = 0; i < 2 && !edges; i++) {
+    int point = config->watchPoint[i] % GATE_HIGH_LIMIT;
+
+    // a multiple of the limit is seen by the limit event
+    if (point == 0 || (i == 1 && point == gate->points[0])) {
+      continue;
+    }
+    ESP_ERROR_CHECK(pcnt_unit_add_watch_point(gate->unit, point));
+    gate->points[i] = point;
+    ESP_LOGI(TAG, "Set watch point %u: %" PRId32, id, config->watchPoint[i]);
+  }
+  return ESP_OK;
+}
+
+esp_err_t gate_start(uint8_t id) {
+  if (id >= GATE_COUNT) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  ESP_ERROR_CHECK(pcnt_unit_clear_count(gates[id].unit));
+  portENTER_CRITICAL(&gate_lock);
+  gates[id].laps = 0;
+  gates[id].read = 0;
+  gates[id].kept = 0;
+  portEXIT_CRITICAL(&gate_lock);
+
+  ESP_ERROR_CHECK(pcnt_unit_start(gates[id].unit));
+  return ESP_OK;
+}
+
+void gate_stop(uint8_t id) {
+  if (id < GATE_COUNT) {
+    pcnt_unit_stop(gates[id].unit);
+  }
+}
+
+/**
+ * @brief Stop the gate and take its watch points away
+ */
+void gate_release(uint8_t id) {
+  if (id >= GATE_COUNT) {
+    return;
+  }
+  gate_t *gate = &gates[id];
+
+  pcnt_unit_stop(gate->unit);
+  remove_points(gate);
+
+  portENTER_CRITICAL(&gate_lock);
+  gate->targets[0] = gate->targets[1] = -1;
+  gate->edges = false;
+  portEXIT_CRITICAL(&gate_lock);
+}
+
+/**
+ * @brief Become the only user of a gate and of its capture
+ *
+ * An experiment holds gate 0 while it is open, a calibration while it
+ * samples, so neither configures the gate under the other.
+ *
+ * @param wait Ticks to wait for the gate
+ * @return false when another user kept it
+ */
+bool gate_take(uint8_t id, TickType_t wait) {
+  return id < GATE_COUNT && xSemaphoreTake(owners[id], wait) == pdTRUE;
+}
+
+/**
+ * @brief Let another user take the gate, after gate_release
+ */
+void gate_give(uint8_t id) {
+  if (id < GATE_COUNT) {
+    xSemaphoreGive(owners[id]);
+  }
+}
+
+/**
+ * @brief Edges counted since gate_start, beyond the limits of the unit
+ *
+ * The edges kept by the capture when they decide the run.
+ */
+int64_t gate_count(uint8_t id) {
+  int before = 0, count = 0;
+  int64_t laps;
+
+  if (id >= GATE_COUNT) {
+    return 0;
+  }
+  gate_t *gate = &gates[id];
+
+  portENTER_CRITICAL(&gate_lock);
+  bool edges = gate->edges;
+  int64_t kept = gate->kept;
+  portEXIT_CRITICAL(&gate_lock);
+  if (edges) {
+    return kept;
+  }
+
+  // the unit only counts up, a lower count after the laps is a wrap between
+  // the reads and starts over
+  do {
+    pcnt_unit_get_count(gate->unit, &before);
+    portENTER_CRITICAL(&gate_lock);
+    laps = gate->laps;
+    portEXIT_CRITICAL(&gate_lock);
+    pcnt_unit_get_count(gate->unit, &count);
+  } while (count < before);
+
+  portENTER_CRITICAL(&gate_lock);
+  int64_t total = laps + count;
+  // the unit wrapped before the reads and cronos() did not add the lap yet
+  if (total < gate->read) {
+    total += GATE_HIGH_LIMIT;
+  }
+  gate->read = total;
+  portEXIT_CRITICAL(&gate_lock);
+
+  return total;
+}
+
+/**
+ * @brief Level of the sensor, 1 when the beam is cut
+ */
+int gate_level(uint8_t id) {
+  return id < GATE_COUNT ? gpio_get_level(gates[id].pin) : 0;
+}
+
+/**
+ * @brief Send the watch points of some gates to a queue of pcnt_stamp_t
+ *
+ * @param gates GATE_BIT of every gate to follow
+ * @param task Notified with bits after each stamp, NULL for none
+ */
+esp_err_t gate_subscribe(uint32_t gates, QueueHandle_t queue,
+                         TaskHandle_t task, uint32_t bits) {
+  esp_err_t err = ESP_ERR_NO_MEM;
+
+  if (queue == NULL || gates == 0 || gates >= GATE_BIT(GATE_COUNT)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  portENTER_CRITICAL(&gate_lock);
+  gate_subscriber_t *slot = NULL;
+  for (uint8_t i = 0; i < GATE_SUBSCRIBERS; i++) {
+    if (subscribers[i].queue == queue) {
+      slot = &subscribers[i];
+      break;
+    }
+    if (slot == NULL && subscribers[i].queue == NULL) {
+      slot = &subscribers[i];
+    }
+  }
+  if (slot != NULL) {
+    *slot = (gate_subscriber_t){
+        .gates = gates,
+        .queue = queue,
+        .task = task,
+        .bits = bits,
+    };
+    err = ESP_OK;
+  }
+  portEXIT_CRITICAL(&gate_lock);
+
+  return err;
+}
+
+void gate_unsubscribe(QueueHandle_t queue) {
+  portENTER_CRITICAL(&gate_lock);
+  for (uint8_t i = 0; i < GATE_SUBSCRIBERS; i++) {
+    if (subscribers[i].queue == queue) {
+      subscribers[i] = (gate_subscriber_t){0};
+    }
+  }
+  portEXIT_CRITICAL(&gate_lock);
+}
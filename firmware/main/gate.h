@@ -0,0 +1,72 @@
+#ifndef __GATE_H__
+#define __GATE_H__
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <latency.h>
+#include <main.h>
+#include <sdkconfig.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Gates
+/* A gate is a sensor on its own PCNT unit, with its own edge actions, glitch
+ * filter and watch points. Every watch point is stamped in the ISR by
+ * esp_timer_get_time, the one timebase of all the gates, and gate_dispatch()
+ * hands it to the subscribers of its gate: a pcnt_stamp_t in their queue and
+ * the bits of their task, so an experiment waits on any set of gates without
+ * polling. The interrupts are served by the core that called gate_init().
+ *
+ * The unit counts up to GATE_HIGH_LIMIT and wraps to zero; its limit events
+ * carry the count in 64 bits, so a run has no cap on its edges and its watch
+ * points may be any count.
+ *
+ * A run with a minimum interval between edges is decided on the capture
+ * instead: only the capture sees that spacing, so its kept edges are the
+ * count. The capture applies the glitch filter of the unit in software, so a
+ * pulse the unit would drop is not counted either. */
+
+#define GATE_COUNT CONFIG_GATE_COUNT
+#define GATE_BIT(gate) (1u << (gate))
+#define GATE_SUBSCRIBERS 2
+#define GATE_QUEUE_SIZE 8
+#define GATE_HIGH_LIMIT 32767
+#define GATE_LOW_LIMIT -32768
+// the capture times the sensor of gate 0
+#if CONFIG_EDGE_CAPTURE
+#define GATE_EDGES(gate) ((gate) == 0)
+#else
+#define GATE_EDGES(gate) false
+#endif
+
+esp_err_t gate_init(void);
+
+bool gate_dispatch(TickType_t wait);
+
+void gate_edge_from_isr(uint8_t gate, uint32_t count, int64_t time,
+                        BaseType_t *high_task_wakeup);
+
+esp_err_t gate_config(uint8_t gate, const experiment_config_t *config);
+
+esp_err_t gate_start(uint8_t gate);
+
+void gate_stop(uint8_t gate);
+
+void gate_release(uint8_t gate);
+
+bool gate_take(uint8_t gate, TickType_t wait);
+
+void gate_give(uint8_t gate);
+
+int64_t gate_count(uint8_t gate);
+
+int gate_level(uint8_t gate);
+
+esp_err_t gate_subscribe(uint32_t gates, QueueHandle_t queue,
+                         TaskHandle_t task, uint32_t bits);
+
+void gate_unsubscribe(QueueHandle_t queue);
+
+#endif // __GATE_H__
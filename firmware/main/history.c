@@ -0,0 +1,130 @@
+#include <history.h>
+#include <sdkconfig.h>
+#include <stats.h>
+#include <stdint.h>
+
+/* Takes the removed result out of the statistics, with the bounds of the
+ * results of its configuration that are left. */
+static void remove_stats(const experiment_data_t *removed) {
+  int64_t min = INT64_MAX;
+  int64_t max = INT64_MIN;
+  size_t size = history_size();
+
+  for (size_t i = 0; i < size; i++) {
+    experiment_data_t data;
+    if (history_at(i, &data) && data.kind == removed->kind &&
+        data.param == removed->param && data.mode == removed->mode) {
+      min = data.timed < min ? data.timed : min;
+      max = data.timed > max ? data.timed : max;
+    }
+  }
+  stats_remove(removed, min, max);
+}
+
+#if CONFIG_RESULT_LOG
+#include <result_log.h>
+
+esp_err_t history_init(void) {
+  esp_err_t err = stats_init();
+  return err == ESP_OK ? result_log_init() : err;
+}
+
+void append_history(experiment_data_t data) {
+  result_log_append(&data);
+  stats_add(&data);
+}
+
+void remove_at_history(size_t index) {
+  experiment_data_t removed;
+
+  if (!result_log_at(index, &removed)) {
+    return;
+  }
+  if (result_log_remove_at(index) == ESP_OK) {
+    remove_stats(&removed);
+  }
+}
+
+/**
+ * @brief Writes the batch in progress and the statistics
+ */
+void save_history(void) {
+  result_log_flush();
+  stats_save();
+}
+
+size_t history_size(void) { return result_log_size(); }
+
+/**
+ * @brief Copies the result at the position, 0 is the oldest
+ */
+bool history_at(size_t index, experiment_data_t *data) {
+  return result_log_at(index, data);
+}
+
+#else
+static experiment_data_t data_history[CONFIG_HISTORY_SIZE];
+
+// index of the oldest result
+static size_t history_head = 0;
+static size_t history_count = 0;
+
+static inline size_t slot(size_t index) {
+  return (history_head + index) % CONFIG_HISTORY_SIZE;
+}
+
+esp_err_t history_init(void) { return stats_init(); }
+
+void append_history(experiment_data_t data) {
+  stats_add(&data);
+
+  if (history_count < CONFIG_HISTORY_SIZE) {
+    data_history[slot(history_count)] = data;
+    history_count++;
+  } else {
+    data_history[history_head] = data;
+    history_head = slot(1);
+  }
+}
+
+/* Moves the shorter side of the ring to close the gap. */
+void remove_at_history(size_t index) {
+  if (index >= history_count) {
+    return;
+  }
+  experiment_data_t removed = data_history[slot(index)];
+
+  if (index < history_count / 2) {
+    for (size_t i = index; i > 0; i--) {
+      data_history[slot(i)] = data_history[slot(i - 1)];
+    }
+    history_head = slot(1);
+  } else {
+    for (size_t i = index; i < history_count - 1; i++) {
+      data_history[slot(i)] = data_history[slot(i + 1)];
+    }
+  }
+
+  history_count--;
+  remove_stats(&removed);
+}
+
+/**
+ * @brief Saves the statistics, the results stay in RAM
+ */
+void save_history(void) { stats_save(); }
+
+size_t history_size(void) { return history_count; }
+
+/**
+ * @brief Copies the result at the position, 0 is the oldest
+ */
+bool history_at(size_t index, experiment_data_t *data) {
+  if (index >= history_count) {
+    return false;
+  }
+
+  *data = data_history[slot(index)];
+  return true;
+}
+#endif
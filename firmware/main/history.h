@@ -0,0 +1,28 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// History
+/* Results are kept as compact binary records in a fixed ring, appending is
+ * O(1) and overwrites the oldest result once full. Text is only made for the
+ * rows that are on the display. With the result log they live in flash and
+ * survive a reset. Every result appended also updates the statistics. */
+
+esp_err_t history_init(void);
+
+void append_history(experiment_data_t data);
+
+void remove_at_history(size_t index);
+
+void save_history(void);
+
+size_t history_size(void);
+
+/* False when the result can not be read. */
+bool history_at(size_t index, experiment_data_t *data);
+
+#endif // __HISTORY_H__
@@ -0,0 +1,63 @@
+#include <esp_timer.h>
+#include <input.h>
+#include <sdkconfig.h>
+#include <stdlib.h>
+
+static int64_t last_change = 0;
+
+/**
+ * @brief Receive an event, with the rotation waiting behind it
+ *
+ * @param queue Queue of rotary_encoder_event_t with a single reader
+ * @param e Event received, untouched when nothing came
+ * @param wait Ticks to wait for the first event
+ * @return false when nothing came before the wait
+ */
+bool input_receive(QueueHandle_t queue, rotary_encoder_event_t *e,
+                   TickType_t wait) {
+  rotary_encoder_event_t next;
+
+  if (xQueueReceive(queue, &next, wait) != pdTRUE) {
+    return false;
+  }
+  *e = next;
+
+  while (e->type == RE_ET_CHANGED && xQueuePeek(queue, &next, 0) == pdTRUE &&
+         next.type == RE_ET_CHANGED) {
+    xQueueReceive(queue, &next, 0);
+    e->diff += next.diff;
+  }
+  return true;
+}
+
+/**
+ * @brief Steps of a delta at the speed of the knob since the last one
+ *
+ * Only once per event, where the encoder is read.
+ */
+int32_t input_accelerate(int32_t diff) {
+  int64_t now = esp_timer_get_time();
+  int64_t elapsed = now - last_change;
+  int64_t speed = elapsed > 0 ? abs(diff) * 1000000LL / elapsed : INT32_MAX;
+  int32_t factor = 1;
+
+  last_change = now;
+  if (speed > INPUT_ACCEL_FROM) {
+    int64_t faster = 1 + (speed - INPUT_ACCEL_FROM) / INPUT_ACCEL_STEP;
+    factor = faster < CONFIG_ENCODER_ACCEL_MAX ? faster
+                                               : CONFIG_ENCODER_ACCEL_MAX;
+  }
+  return diff * factor;
+}
+
+/**
+ * @brief Move a value by a delta, held between min and max
+ */
+int32_t input_step(int32_t value, int32_t diff, int32_t min, int32_t max) {
+  int64_t moved = (int64_t)value + diff;
+
+  if (moved < min) {
+    return min;
+  }
+  return moved > max ? max : moved;
+}
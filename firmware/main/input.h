@@ -0,0 +1,30 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <encoder.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Input
+/* A spin of the encoder is handled as one event. input_receive() merges the
+ * RE_ET_CHANGED waiting behind the first one into a single delta, and
+ * input_accelerate() makes each detent worth more steps the faster the knob
+ * turns. A screen moves by the whole delta with input_step() and redraws
+ * once, however many detents it was. */
+
+#define INPUT_QUEUE_SIZE 16
+// under this speed a detent is one step
+#define INPUT_ACCEL_FROM 8 // detents per second
+// one more step per detent each time the speed grows by
+#define INPUT_ACCEL_STEP 8 // detents per second
+
+bool input_receive(QueueHandle_t queue, rotary_encoder_event_t *e,
+                   TickType_t wait);
+
+int32_t input_accelerate(int32_t diff);
+
+int32_t input_step(int32_t value, int32_t diff, int32_t min, int32_t max);
+
+#endif // __INPUT_H__
@@ -0,0 +1,183 @@
+#include <knob.h>
+
+#if CONFIG_ENCODER_BACKEND_PCNT
+#include <driver/gpio.h>
+#include <driver/pulse_cnt.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+static const char *TAG = "knob";
+
+static QueueHandle_t knob_queue = NULL;
+static pcnt_unit_handle_t knob_unit = NULL;
+static esp_timer_handle_t debounce_timer = NULL;
+static esp_timer_handle_t long_press_timer = NULL;
+
+// sender of the events, only the button state is used
+static rotary_encoder_t knob = {
+    .pin_a = CONFIG_ENCODER_CLK,
+    .pin_b = CONFIG_ENCODER_DT,
+    .pin_btn = CONFIG_ENCODER_SW,
+    .btn_state = RE_BTN_RELEASED,
+};
+
+static const pcnt_unit_config_t config_unit = {
+    .high_limit = CONFIG_ENCODER_COUNTS_PER_DETENT,
+    .low_limit = -CONFIG_ENCODER_COUNTS_PER_DETENT,
+};
+
+static void send(rotary_encoder_event_type_t type) {
+  rotary_encoder_event_t e = {.type = type, .sender = &knob};
+  xQueueSendToBack(knob_queue, &e, 0);
+}
+
+/* A limit is one detent, and the unit is back to zero. */
+static bool detent(pcnt_unit_handle_t unit,
+                   const pcnt_watch_event_data_t *edata, void *user_ctx) {
+  rotary_encoder_event_t e = {
+      .type = RE_ET_CHANGED,
+      .sender = &knob,
+      .diff = edata->watch_point_value > 0 ? 1 : -1,
+  };
+  BaseType_t high_task_wakeup = pdFALSE;
+
+  xQueueSendFromISR(knob_queue, &e, &high_task_wakeup);
+  return (high_task_wakeup == pdTRUE);
+}
+
+/* Every bounce starts the debounce over, the level is read once it is
+ * quiet. */
+static void IRAM_ATTR button_isr(void *args) {
+  esp_timer_stop(debounce_timer);
+  esp_timer_start_once(debounce_timer, KNOB_DEBOUNCE_US);
+}
+
+/* Same events as the encoder component: pressed, then long pressed when it is
+ * held, and on the release a click unless it was long. */
+static void button_settled(void *args) {
+  bool pressed = gpio_get_level(CONFIG_ENCODER_SW) == KNOB_PRESSED_LEVEL;
+
+  if (pressed && knob.btn_state == RE_BTN_RELEASED) {
+    knob.btn_state = RE_BTN_PRESSED;
+    send(RE_ET_BTN_PRESSED);
+    esp_timer_start_once(long_press_timer, KNOB_LONG_PRESS_US);
+  } else if (!pressed && knob.btn_state != RE_BTN_RELEASED) {
+    bool clicked = knob.btn_state == RE_BTN_PRESSED;
+
+    esp_timer_stop(long_press_timer);
+    knob.btn_state = RE_BTN_RELEASED;
+    send(RE_ET_BTN_RELEASED);
+    if (clicked) {
+      send(RE_ET_BTN_CLICKED);
+    }
+  }
+}
+
+static void button_held(void *args) {
+  if (knob.btn_state == RE_BTN_PRESSED) {
+    knob.btn_state = RE_BTN_LONG_PRESSED;
+    send(RE_ET_BTN_LONG_PRESSED);
+  }
+}
+
+static esp_err_t knob_rotation_init(void) {
+  pcnt_glitch_filter_config_t config_filter = {
+      .max_glitch_ns = CONFIG_ENCODER_GLITCH_NS,
+  };
+  pcnt_chan_config_t config_a = {
+      .edge_gpio_num = CONFIG_ENCODER_CLK,
+      .level_gpio_num = CONFIG_ENCODER_DT,
+  };
+  pcnt_chan_config_t config_b = {
+      .edge_gpio_num = CONFIG_ENCODER_DT,
+      .level_gpio_num = CONFIG_ENCODER_CLK,
+  };
+  pcnt_channel_handle_t chan_a, chan_b;
+  pcnt_event_callbacks_t callbacks = {
+      .on_reach = detent,
+  };
+
+  /* The quadrature decoding of the rotary encoder example:
+   * https://github.com/espressif/esp-idf/tree/v5.1.2/examples/peripherals/pcnt/rotary_encoder
+   */
+  ESP_ERROR_CHECK(pcnt_new_unit(&config_unit, &knob_unit));
+  ESP_ERROR_CHECK(pcnt_unit_set_glitch_filter(knob_unit, &config_filter));
+  ESP_ERROR_CHECK(pcnt_new_channel(knob_unit, &config_a, &chan_a));
+  ESP_ERROR_CHECK(pcnt_new_channel(knob_unit, &config_b, &chan_b));
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(
+      chan_a, PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+      PCNT_CHANNEL_EDGE_ACTION_INCREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(
+      chan_a, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+      PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(
+      chan_b, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+      PCNT_CHANNEL_EDGE_ACTION_DECREASE));
+  ESP_ERROR_CHECK(pcnt_channel_set_level_action(
+      chan_b, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+      PCNT_CHANNEL_LEVEL_ACTION_INVERSE));
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(
+      knob_unit, CONFIG_ENCODER_COUNTS_PER_DETENT));
+  ESP_ERROR_CHECK(pcnt_unit_add_watch_point(
+      knob_unit, -CONFIG_ENCODER_COUNTS_PER_DETENT));
+  ESP_ERROR_CHECK(
+      pcnt_unit_register_event_callbacks(knob_unit, &callbacks, NULL));
+  ESP_ERROR_CHECK(pcnt_unit_enable(knob_unit));
+  ESP_ERROR_CHECK(pcnt_unit_clear_count(knob_unit));
+  ESP_ERROR_CHECK(pcnt_unit_start(knob_unit));
+  return ESP_OK;
+}
+
+static esp_err_t knob_button_init(void) {
+  esp_timer_create_args_t debounce_args = {
+      .callback = button_settled,
+      .name = "knob debounce",
+  };
+  esp_timer_create_args_t long_press_args = {
+      .callback = button_held,
+      .name = "knob long press",
+  };
+  gpio_config_t config_button = {
+      .pin_bit_mask = 1ULL << CONFIG_ENCODER_SW,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = KNOB_PRESSED_LEVEL == 0 ? GPIO_PULLUP_ENABLE
+                                            : GPIO_PULLUP_DISABLE,
+      .pull_down_en = KNOB_PRESSED_LEVEL == 0 ? GPIO_PULLDOWN_DISABLE
+                                              : GPIO_PULLDOWN_ENABLE,
+      .intr_type = GPIO_INTR_ANYEDGE,
+  };
+
+  ESP_ERROR_CHECK(esp_timer_create(&debounce_args, &debounce_timer));
+  ESP_ERROR_CHECK(esp_timer_create(&long_press_args, &long_press_timer));
+  ESP_ERROR_CHECK(gpio_config(&config_button));
+
+  esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  // the capture installs it on the timing core when it runs first
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    return err;
+  }
+  return gpio_isr_handler_add(CONFIG_ENCODER_SW, button_isr, NULL);
+}
+
+/**
+ * @brief Start the PCNT backend of the rotary encoder
+ *
+ * @param queue Queue of rotary_encoder_event_t, as for rotary_encoder_init
+ */
+esp_err_t knob_init(QueueHandle_t queue) {
+  knob_queue = queue;
+
+  ESP_ERROR_CHECK(knob_rotation_init());
+  ESP_ERROR_CHECK(knob_button_init());
+
+  ESP_LOGI(TAG, "Encoder on PCNT, %d counts per detent, filter of %dns",
+           CONFIG_ENCODER_COUNTS_PER_DETENT, CONFIG_ENCODER_GLITCH_NS);
+  return ESP_OK;
+}
+
+#else
+
+esp_err_t knob_init(QueueHandle_t queue) { return ESP_ERR_NOT_SUPPORTED; }
+
+#endif // CONFIG_ENCODER_BACKEND_PCNT
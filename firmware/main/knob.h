@@ -0,0 +1,34 @@
+#ifndef __KNOB_H__
+#define __KNOB_H__
+
+#include <encoder.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <sdkconfig.h>
+
+// Knob
+/* Backend of the rotary encoder on a PCNT unit, in place of the polling timer
+ * of the encoder component. The unit decodes CLK and DT in quadrature behind
+ * the glitch filter and only interrupts when the count reaches a detent,
+ * then it is back to zero. The button interrupts on its edges, which start a
+ * debounce timer. Both send the same rotary_encoder_event_t as the encoder
+ * component, so map() does not know which backend runs. */
+
+// the same button as the encoder component, when it is built
+#ifdef CONFIG_RE_BTN_LONG_PRESS_TIME_US
+#define KNOB_LONG_PRESS_US CONFIG_RE_BTN_LONG_PRESS_TIME_US
+#else
+#define KNOB_LONG_PRESS_US 500000
+#endif
+#ifdef CONFIG_RE_BTN_PRESSED_LEVEL
+#define KNOB_PRESSED_LEVEL CONFIG_RE_BTN_PRESSED_LEVEL
+#else
+#define KNOB_PRESSED_LEVEL 0
+#endif
+// bounces of the button end before
+#define KNOB_DEBOUNCE_US 5000
+
+esp_err_t knob_init(QueueHandle_t queue);
+
+#endif // __KNOB_H__
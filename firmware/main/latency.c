@@ -0,0 +1,162 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <latency.h>
+#include <sdkconfig.h>
+#include <string.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <virtual_clock.h>
+#else
+#include <esp_cpu.h>
+#endif
+
+static const char *TAG = "latency";
+
+const char *latency_stage_label[LATENCY_STAGES] = {
+    "E>W",
+    "I>T",
+    "E>T",
+    "E>D",
+};
+
+static latency_histogram_t histograms[LATENCY_STAGES];
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t cycles_to_ns(uint32_t cycles) {
+  return (uint64_t)cycles * 1000 / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+}
+
+void latency_record(latency_stage_t stage, uint32_t ns) {
+  latency_histogram_t *h = &histograms[stage];
+  uint8_t bucket = ns == 0 ? 0 : 31 - __builtin_clz(ns);
+
+  portENTER_CRITICAL(&latency_lock);
+  if (h->count == 0 || ns < h->min) {
+    h->min = ns;
+  }
+  if (ns > h->max) {
+    h->max = ns;
+  }
+  h->buckets[bucket]++;
+  h->count++;
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+/**
+ * @brief Stamp the event of the PCNT when the timing task take it
+ *
+ * @param stamp Event received, with the stamps of cronos()
+ */
+void latency_dequeued(pcnt_stamp_t *stamp) {
+  stamp->task_cycles = esp_cpu_get_cycle_count();
+  stamp->task_time = esp_timer_get_time();
+  stamp->task_core = esp_cpu_get_core_id();
+
+  // cycle counters of the two cores are not synchronized
+  if (stamp->task_core == stamp->isr_core) {
+    latency_record(LATENCY_ISR_TO_TASK,
+                   cycles_to_ns(stamp->task_cycles - stamp->isr_cycles));
+  } else {
+    latency_record(LATENCY_ISR_TO_TASK,
+                   (stamp->task_time - stamp->time) * 1000);
+  }
+}
+
+/**
+ * @brief Age of every counted edge when the experiment task drains it
+ *
+ * @param events Edges just taken from the ring
+ * @param n Number of edges
+ */
+void latency_drained(const edge_event_t *events, size_t n) {
+  int64_t now = esp_timer_get_time() * 1000;
+
+  for (size_t i = 0; i < n; i++) {
+    if (!events[i].counted || now < events[i].time) {
+      continue;
+    }
+    int64_t age = now - events[i].time;
+    latency_record(LATENCY_EDGE_TO_DRAIN, age < UINT32_MAX ? age : UINT32_MAX);
+  }
+}
+
+/**
+ * @brief Measure how late the watch points were seen after their edges
+ *
+ * @param run Edges of the run
+ * @param watchPoint Counts that start and stop the experiment
+ * @param stamps Events of the two watch points received by the task
+ */
+void latency_record_run(const edge_run_t *run, const int32_t watchPoint[2],
+                        const pcnt_stamp_t stamps[2]) {
+  for (uint8_t i = 0; i < 2; i++) {
+    const edge_event_t *edge = capture_find_edge(run, watchPoint[i]);
+    if (edge == NULL) {
+      continue;
+    }
+    // the capture stamps its own watch points with the time of the edge
+    if (stamps[i].time != edge->time / 1000 &&
+        stamps[i].time * 1000 >= edge->time) {
+      latency_record(LATENCY_EDGE_TO_WATCH,
+                     stamps[i].time * 1000 - edge->time);
+    }
+    if (stamps[i].task_time * 1000 >= edge->time) {
+      latency_record(LATENCY_EDGE_TO_TASK,
+                     stamps[i].task_time * 1000 - edge->time);
+    }
+  }
+}
+
+void latency_snapshot(latency_stage_t stage, latency_histogram_t *histogram) {
+  portENTER_CRITICAL(&latency_lock);
+  *histogram = histograms[stage];
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+/**
+ * @brief Upper bound of the bucket that holds the percentile
+ *
+ * @return Nanoseconds, never more than the max seen
+ */
+uint32_t latency_percentile(const latency_histogram_t *histogram,
+                            uint8_t percent) {
+  uint64_t target = ((uint64_t)histogram->count * percent + 99) / 100;
+  uint64_t seen = 0;
+
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= target && seen > 0) {
+      uint64_t upper = (2ULL << i) - 1;
+      return upper < histogram->max ? upper : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+void latency_reset(void) {
+  portENTER_CRITICAL(&latency_lock);
+  memset(histograms, 0, sizeof(histograms));
+  portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_dump(void) {
+  latency_histogram_t h;
+
+  for (uint8_t stage = 0; stage < LATENCY_STAGES; stage++) {
+    latency_snapshot(stage, &h);
+    ESP_LOGI(TAG,
+             "%s count: %" PRIu32 " min: %" PRIu32 "ns p99: %" PRIu32
+             "ns max: %" PRIu32 "ns",
+             latency_stage_label[stage], h.count, h.min,
+             latency_percentile(&h, 99), h.max);
+
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+      if (h.buckets[i] > 0) {
+        ESP_LOGI(TAG, "  [%10" PRIu32 ", %10" PRIu32 "] %" PRIu32,
+                 (uint32_t)(1ULL << i) & ~1U, (uint32_t)((2ULL << i) - 1),
+                 h.buckets[i]);
+      }
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <capture.h>
+#include <stdint.h>
+#include <time.h>
+
+// Latency
+/* Always-on instrumentation of the path from a sensor edge to the experiment
+ * task. Every stage keeps a histogram of power of two buckets in nanoseconds,
+ * so recording a sample is a few instructions and the p99 is an upper bound
+ * of its bucket.
+ *
+ * The edges are the times of the capture, the stamps the esp_timer of the
+ * interrupt that reported a watch point. E>W and E>T take the two watch points
+ * of each run; the capture stamps its own watch points with the edge, so E>W
+ * stays empty for a run counted on the capture. E>D takes every counted edge,
+ * when the experiment task drains it from the ring. */
+
+#define LATENCY_BUCKETS 32
+
+typedef enum {
+  LATENCY_EDGE_TO_WATCH = 0, // edge to the stamp of its watch point
+  LATENCY_ISR_TO_TASK,       // stamp to the timing task
+  LATENCY_EDGE_TO_TASK,      // edge to the timing task
+  LATENCY_EDGE_TO_DRAIN,     // edge to the drain of the experiment task
+  LATENCY_STAGES,
+} latency_stage_t;
+
+typedef struct {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+} latency_histogram_t;
+
+// Stamps taken when cronos() runs and when the timing task dequeue its event
+typedef struct {
+  time_t time;
+  uint32_t isr_cycles;
+  uint32_t task_cycles;
+  time_t task_time;
+  uint8_t isr_core;
+  uint8_t task_core;
+  uint8_t gate;
+  int32_t watch_point;
+} pcnt_stamp_t;
+
+extern const char *latency_stage_label[LATENCY_STAGES];
+
+void latency_record(latency_stage_t stage, uint32_t ns);
+
+void latency_dequeued(pcnt_stamp_t *stamp);
+
+void latency_drained(const edge_event_t *events, size_t n);
+
+void latency_record_run(const edge_run_t *run, const int32_t watchPoint[2],
+                        const pcnt_stamp_t stamps[2]);
+
+void latency_snapshot(latency_stage_t stage, latency_histogram_t *histogram);
+
+uint32_t latency_percentile(const latency_histogram_t *histogram,
+                            uint8_t percent);
+
+void latency_reset(void);
+
+void latency_dump(void);
+
+#endif // __LATENCY_H__
@@ -0,0 +1,61 @@
+#include <esp_log.h>
+#include <i2cdev.h>
+#include <lcd_bus.h>
+#include <pcf8574.h>
+#include <sdkconfig.h>
+#include <stdbool.h>
+
+static const char *TAG = "lcd_bus";
+
+static i2c_dev_t pcf8574;
+
+static uint8_t batch[LCD_BUS_BATCH_SIZE];
+static size_t batch_len = 0;
+static bool batching = false;
+
+esp_err_t lcd_bus_init(void) {
+  ESP_ERROR_CHECK(pcf8574_init_desc(&pcf8574, CONFIG_DISPLAY_ADDR, 0,
+                                    CONFIG_I2C_SDA, CONFIG_I2C_SCL));
+  pcf8574.cfg.master.clk_speed = CONFIG_DISPLAY_I2C_FREQ;
+
+  ESP_LOGI(TAG, "PCF8574 at %" PRIu32 "Hz", (uint32_t)CONFIG_DISPLAY_I2C_FREQ);
+  return ESP_OK;
+}
+
+static esp_err_t send_batch(void) {
+  esp_err_t err = ESP_OK;
+
+  if (batch_len > 0) {
+    err = i2c_dev_write(&pcf8574, NULL, 0, batch, batch_len);
+    batch_len = 0;
+  }
+  return err;
+}
+
+/**
+ * @brief write_cb of the hd44780_t, one state of the expander port
+ */
+esp_err_t lcd_bus_write(const hd44780_t *lcd, uint8_t data) {
+  if (!batching) {
+    return pcf8574_port_write(&pcf8574, data);
+  }
+
+  if (batch_len == LCD_BUS_BATCH_SIZE) {
+    esp_err_t err = send_batch();
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+
+  batch[batch_len++] = data;
+  return ESP_OK;
+}
+
+/* Commands that need a long delay (clear, home) must stay out of a batch,
+ * the delay of hd44780 runs while the bytes are still in the buffer. */
+void lcd_bus_begin(void) { batching = true; }
+
+esp_err_t lcd_bus_end(void) {
+  batching = false;
+  return send_batch();
+}
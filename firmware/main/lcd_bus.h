@@ -0,0 +1,24 @@
+#ifndef __LCD_BUS_H__
+#define __LCD_BUS_H__
+
+#include <esp_err.h>
+#include <hd44780.h>
+#include <stdint.h>
+
+// LCD Bus
+/* Transport of the HD44780 over the PCF8574 expander. Between begin and end
+ * every expander state that hd44780 sends through write_cb is kept in a
+ * buffer and sent as one multi-byte I2C write, the PCF8574 latches each byte
+ * of the write on its port in order. */
+
+#define LCD_BUS_BATCH_SIZE 128
+
+esp_err_t lcd_bus_init(void);
+
+esp_err_t lcd_bus_write(const hd44780_t *lcd, uint8_t data);
+
+void lcd_bus_begin(void);
+
+esp_err_t lcd_bus_end(void);
+
+#endif // __LCD_BUS_H__
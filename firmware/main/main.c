@@ -1,3 +1,7 @@
+#include <capture.h>
+#include <console.h>
+#include <damping.h>
+#include <display.h>
 #include <driver/gpio.h>
 #include <driver/ledc.h>
 #include <driver/pulse_cnt.h>
@@ -5,56 +9,78 @@
 #include <esp_log.h>
 #include <esp_random.h>
 #include <esp_timer.h>
+#include <filter.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/portmacro.h>
 #include <freertos/projdefs.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <gate.h>
 #include <hal/ledc_types.h>
 #include <hal/pcnt_types.h>
 #include <hd44780.h>
+#include <history.h>
 #include <i2cdev.h>
+#include <input.h>
+#include <knob.h>
+#include <latency.h>
+#include <lcd_bus.h>
 #include <main.h>
 #include <math.h>
 #include <menu_manager.h>
 #include <nvs.h>
 #include <nvs_flash.h>
-#include <pcf8574.h>
+#include <period_fit.h>
+#include <replay.h>
 #include <sdkconfig.h>
+#include <stats.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stream.h>
 #include <string.h>
 #include <time.h>
+#include <time_format.h>
+#include <timing.h>
 
 #define H_POSITION_HOURGLASS 3
 #define V_POSITION_HOURGLASS 2
+#define HOURGLASS_FIRST_FRAME 4
+#define HOURGLASS_FRAMES 4
+#define HOURGLASS_PERIOD_US 500000
 #define PERCENT_TO_10_BIT(percent) ((uint32_t)(5 * pow(1.069, percent)))
+#define REFRESH_PERIOD_US 40000
 
 static const char *TAG = "main";
 
 menu_node_t root = {
     .label = "Main  Menu",
-    .num_options = 5,
+    .num_options = 6,
     .submenus = root_options,
 };
 
-menu_node_t root_options[5] = {
+menu_node_t root_options[6] = {
     {.label = "Pendulum", .function = &Pendulum},
     {.label = "Spring", .function = &Spring},
     {.label = "Mechanical Energy", .function = &Energy},
     {.label = "History", .function = &History},
-    {.label = "Settings", .submenus = settings_options, .num_options = 3},
+    {.label = "Statistics", .function = &Statistics},
+    {.label = "Settings", .submenus = settings_options, .num_options = 6},
 };
 
 char menu_type_label[15];
 char brightness_label[16];
-menu_node_t settings_options[3] = {
+char result_mode_label[16];
+char damping_mode_label[13];
+menu_node_t settings_options[6] = {
     {.label = menu_type_label, .function = &Change_menu},
     {.label = brightness_label, .function = &Brightness},
+    {.label = result_mode_label, .function = &Change_result},
+    {.label = damping_mode_label, .function = &Change_damping},
+    {.label = "Diagnostics", .function = &Diagnostics},
     {.label = "Info", .function = &Info},
 };
 
@@ -67,14 +93,23 @@ switch_menu_t options_display[2] = {
 };
 
 uint8_t brightness;
+uint8_t result_mode;
+const char *result_mode_names[2] = {"Period: 2 edges", "Period: LSQ fit"};
+uint8_t damping_mode;
 
 void app_main(void) {
 
   ESP_ERROR_CHECK(startNVS());
+  ESP_ERROR_CHECK(history_init());
+  ESP_ERROR_CHECK(filter_init());
   ESP_ERROR_CHECK(startPWM());
   ESP_ERROR_CHECK(startLCD());
-  ESP_ERROR_CHECK(startEncoder());
+  // after the timing, which installs the GPIO interrupts on its core
   ESP_ERROR_CHECK(startPCNT());
+  ESP_ERROR_CHECK(startEncoder());
+  ESP_ERROR_CHECK(console_init());
+  ESP_ERROR_CHECK(stream_init());
+  ESP_ERROR_CHECK(replay_init());
 
   config_menu.root = root;
   config_menu.input = &map;
@@ -82,22 +117,17 @@ void app_main(void) {
   config_menu.loop = options_display[option_type_menu].loop_menu;
 
   xTaskCreatePinnedToCore(&menu_init, "menu_init", 2048, &config_menu, 1, NULL,
-                          0);
+                          UI_CORE);
   vTaskDelete(NULL);
 }
 
-TaskHandle_t tHourglass = NULL;
 TaskHandle_t tCheckSensor = NULL;
-SemaphoreHandle_t sDisplay = NULL;
-pcnt_unit_handle_t pcnt_unit = NULL;
-pcnt_channel_handle_t pcnt_chan = NULL;
+TaskHandle_t tExperiment = NULL;
 QueueHandle_t qPCNT = NULL;
 QueueHandle_t qEncoder;
 QueueHandle_t qCommand;
 nvs_handle_t nvs;
 
-int32_t currentWatchers[2] = {-1, -1};
-
 esp_err_t startNVS(void) {
 
   /* Good Example that Non-Volative Storage:
@@ -153,28 +183,68 @@ esp_err_t startNVS(void) {
       return err;
     }
     snprintf(brightness_label, 16, "Brightness %03d%%", brightness);
+
+    err = nvs_get_u8(nvs, "resultmode", &result_mode);
+    switch (err) {
+    case ESP_OK:
+      ESP_LOGI(TAG, "Done");
+      ESP_LOGI(TAG, "Result Mode = %d", result_mode);
+      break;
+    case ESP_ERR_NVS_NOT_FOUND:
+      ESP_LOGW(TAG, "The value is not initialized yet!");
+      result_mode = RESULT_TWO_EDGES;
+      err = ESP_OK;
+      break;
+    default:
+      ESP_LOGE(TAG, "Error (%s) reading!", esp_err_to_name(err));
+      return err;
+    }
+    strncpy(result_mode_label, result_mode_names[result_mode & 1], 16);
+
+    err = nvs_get_u8(nvs, "damping", &damping_mode);
+    switch (err) {
+    case ESP_OK:
+      ESP_LOGI(TAG, "Done");
+      ESP_LOGI(TAG, "Damping = %d", damping_mode);
+      break;
+    case ESP_ERR_NVS_NOT_FOUND:
+      ESP_LOGW(TAG, "The value is not initialized yet!");
+      damping_mode = 0;
+      err = ESP_OK;
+      break;
+    default:
+      ESP_LOGE(TAG, "Error (%s) reading!", esp_err_to_name(err));
+      return err;
+    }
+    snprintf(damping_mode_label, 13, "Damping: %s", damping_mode ? "On" : "Off");
   }
   nvs_close(nvs);
 
   return err;
 }
 
+#if !CONFIG_ENCODER_BACKEND_PCNT
 static rotary_encoder_t re = {
     .pin_a = CONFIG_ENCODER_CLK,
     .pin_b = CONFIG_ENCODER_DT,
     .pin_btn = CONFIG_ENCODER_SW,
 };
+#endif // !CONFIG_ENCODER_BACKEND_PCNT
 
 esp_err_t startEncoder(void) {
   // Queue with command that control Menu_Manager
-  qEncoder = xQueueCreate(5, sizeof(rotary_encoder_event_t));
+  qEncoder = xQueueCreate(INPUT_QUEUE_SIZE, sizeof(rotary_encoder_event_t));
   // Queue with command that might control function
-  qCommand = xQueueCreate(5, sizeof(rotary_encoder_event_t));
+  qCommand = xQueueCreate(INPUT_QUEUE_SIZE, sizeof(rotary_encoder_event_t));
 
+#if CONFIG_ENCODER_BACKEND_PCNT
+  ESP_ERROR_CHECK(knob_init(qEncoder));
+#else
   /* Documentation rotatory Encoder:
    * https://esp-idf-lib.readthedocs.io/en/latest/groups/encoder.html */
   ESP_ERROR_CHECK(rotary_encoder_init(qEncoder));
   ESP_ERROR_CHECK(rotary_encoder_add(&re));
+#endif // CONFIG_ENCODER_BACKEND_PCNT
   return ESP_OK;
 }
 
@@ -215,13 +285,7 @@ esp_err_t startPWM(void) {
 /* Good example that control LCD with I2C with this component:
  * https://github.com/UncleRus/esp-idf-lib/tree/master/examples/hd44780/i2c */
 
-static i2c_dev_t pcf8574;
-
-static esp_err_t write_lcd_data(const hd44780_t *lcd, uint8_t data) {
-  return pcf8574_port_write(&pcf8574, data);
-}
-
-hd44780_t lcd = {.write_cb = write_lcd_data,
+hd44780_t lcd = {.write_cb = lcd_bus_write,
                  .font = HD44780_FONT_5X8,
                  .lines = CONFIG_VERTICAL_SIZE,
                  .pins = {
@@ -254,11 +318,20 @@ static const uint8_t char_data[] = {
     // HourGlass 4 - 7
     0x1F, 0x11, 0x0A, 0x04, 0x04, 0x0E, 0x1F, 0x1F};
 
+esp_timer_handle_t hourglass_timer = NULL;
+volatile bool hourglass_running = false;
+uint8_t hourglass_frame = 0;
+
+static void hourglass_tick(void *args);
+
+esp_timer_create_args_t hourglass_timer_args = {
+    .callback = hourglass_tick,
+    .name = "hourglass",
+};
+
 esp_err_t startLCD(void) {
   ESP_ERROR_CHECK(i2cdev_init());
-  vSemaphoreCreateBinary(sDisplay);
-  ESP_ERROR_CHECK(pcf8574_init_desc(&pcf8574, CONFIG_DISPLAY_ADDR, 0,
-                                    CONFIG_I2C_SDA, CONFIG_I2C_SCL));
+  ESP_ERROR_CHECK(lcd_bus_init());
 
   hd44780_switch_backlight(&lcd, true);
   ESP_ERROR_CHECK(hd44780_init(&lcd));
@@ -268,32 +341,45 @@ esp_err_t startLCD(void) {
   }
   ESP_LOGI(TAG, "LCD ON!");
 
-  return ESP_OK;
-}
-
-void hd44780_clear_line(const hd44780_t *lcd, uint8_t line) {
+  ESP_ERROR_CHECK(display_init(&lcd));
 
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
+  return esp_timer_create(&hourglass_timer_args, &hourglass_timer);
+}
 
-  hd44780_gotoxy(lcd, 0, line);
-  hd44780_puts(lcd, "                    ");
-  hd44780_gotoxy(lcd, 0, line);
+/* The hourglass is animated by one persistent timer, so starting and
+ * stopping an experiment never allocates nor kills a task. It runs in the
+ * esp_timer task with the other timers, a frame is skipped rather than wait
+ * for a full display queue. */
+static void hourglass_tick(void *args) {
+  if (hourglass_running) {
+    display_try_putc(H_POSITION_HOURGLASS, V_POSITION_HOURGLASS,
+                     HOURGLASS_FIRST_FRAME + hourglass_frame);
+    hourglass_frame = (hourglass_frame + 1) % HOURGLASS_FRAMES;
+  }
+}
 
-  xSemaphoreGive(sDisplay);
+void hourglass_start(void) {
+  hourglass_frame = 0;
+  hourglass_running = true;
+  esp_timer_start_periodic(hourglass_timer, HOURGLASS_PERIOD_US);
 }
 
-void HourGlass_animation(void *args) {
-  while (true) {
-    for (uint8_t _ = 4; _ < 8; _++) {
-      xSemaphoreTake(sDisplay, portMAX_DELAY);
-      hd44780_gotoxy(&lcd, H_POSITION_HOURGLASS, V_POSITION_HOURGLASS);
-      hd44780_putc(&lcd, _);
-      xSemaphoreGive(sDisplay);
-      vTaskDelay(pdMS_TO_TICKS(500));
-    }
-  }
+/**
+ * @brief Stop the animation and leave the resting hourglass on the display
+ */
+void hourglass_stop(void) {
+  hourglass_running = false;
+  // fails when the timer is not running, and that is fine
+  esp_timer_stop(hourglass_timer);
+
+  display_putc(H_POSITION_HOURGLASS, V_POSITION_HOURGLASS,
+               HOURGLASS_FIRST_FRAME + HOURGLASS_FRAMES - 1);
+  display_flush();
 }
 
+// steps left of the last delta of the encoder in the menu
+int32_t menu_steps = 0;
+
 /**
  * @brief Convert command received of the rotatory encoder to Menu Manager
  *
@@ -301,12 +387,29 @@ void HourGlass_animation(void *args) {
  */
 Navigate_t map(void) {
   rotary_encoder_event_t e;
+
+  // the menu takes a delta one step at a time, it redraws after the last
+  if (menu_steps != 0 && xSemaphoreTake(Menu_mutex, 0) == pdTRUE) {
+    xSemaphoreGive(Menu_mutex);
+    if (menu_steps > 0) {
+      menu_steps--;
+      return NAVIGATE_UP;
+    }
+    menu_steps++;
+    return NAVIGATE_DOWN;
+  }
+  menu_steps = 0;
+
   // filter possibles inputs of the encoder
   do {
-    xQueueReceive(qEncoder, &e, portMAX_DELAY);
+    input_receive(qEncoder, &e, portMAX_DELAY);
 
   } while (e.type == RE_ET_BTN_PRESSED || e.type == RE_ET_BTN_RELEASED);
 
+  if (e.type == RE_ET_CHANGED) {
+    e.diff = input_accelerate(e.diff);
+  }
+
   // semaphore to Menu Menager if occuped a function was executed
   if (xSemaphoreTake(Menu_mutex, 0) == pdTRUE) {
     xSemaphoreGive(Menu_mutex);
@@ -323,25 +426,23 @@ Navigate_t map(void) {
 
     case RE_ET_CHANGED:
       if (e.diff > 0) {
-        ESP_LOGI(TAG, "UP");
+        ESP_LOGI(TAG, "UP %" PRId32, e.diff);
+        menu_steps = e.diff - 1;
         return NAVIGATE_UP;
-      } else {
-        ESP_LOGI(TAG, "DOWN");
+      } else if (e.diff < 0) {
+        ESP_LOGI(TAG, "DOWN %" PRId32, -e.diff);
+        menu_steps = e.diff + 1;
         return NAVIGATE_DOWN;
       }
+      break;
     default:
       ESP_LOGI(TAG, "NOTHING");
     }
   } else if (e.type == RE_ET_BTN_LONG_PRESSED) {
 
-    hd44780_control(&lcd, true, false, false);
-
-    xSemaphoreGive(sDisplay);
+    display_cursor(false, 0, 0);
 
-    if (tHourglass != NULL) {
-      vTaskDelete(tHourglass);
-      tHourglass = NULL;
-    }
+    hourglass_stop();
 
     if (tCheckSensor != NULL) {
       vTaskDelete(tCheckSensor);
@@ -351,12 +452,19 @@ Navigate_t map(void) {
     ledc_set_duty(ledMode, ledChannel, PERCENT_TO_10_BIT(brightness));
     ledc_update_duty(ledMode, ledChannel);
 
-    for (uint8_t i = 0; i < 2; i++) {
-      if (currentWatchers[i] > 0) {
-        ESP_ERROR_CHECK(
-            pcnt_unit_remove_watch_point(pcnt_unit, currentWatchers[i]));
-      }
-      currentWatchers[i] = -1;
+    // only an experiment took the gate
+    bool owner = tExperiment != NULL;
+
+    capture_stop();
+    refresh_stop();
+    gate_unsubscribe(qPCNT);
+    tExperiment = NULL;
+    console_detach();
+
+    gate_release(0);
+    if (owner) {
+      gate_give(0);
+      save_history();
     }
 
     ESP_LOGI(TAG, "BACK");
@@ -365,12 +473,82 @@ Navigate_t map(void) {
     // Redirect command to function executed
     //
     xQueueSend(qCommand, &e, 0);
+    if (tExperiment != NULL) {
+      xTaskNotify(tExperiment, EVENT_COMMAND, eSetBits);
+    }
   }
   return NAVIGATE_NOTHING;
 }
 
-uint8_t first = 0, end = 0;
-const char *old_title;
+// Menu screen
+/* The menu keeps what it left on the LCD and only sends what moved. The
+ * labels start after the cursor column, so a cursor move is two cells, a
+ * scroll rewrites the rows whose label changed and the title is drawn when a
+ * menu is entered. Every other screen starts with display_clear(), so a count
+ * of clears that moved means the next menu frame is drawn whole. */
+
+#define MENU_ROWS (CONFIG_VERTICAL_SIZE - 1)
+#define MENU_LABEL_X 2
+#define MENU_LABEL_SIZE (CONFIG_HORIZONTAL_SIZE - MENU_LABEL_X)
+
+typedef struct {
+  const char *title;
+  uint32_t clears;
+  uint8_t cursor;
+  char rows[MENU_ROWS][MENU_LABEL_SIZE + 1];
+} menu_screen_t;
+
+menu_screen_t menu_screen = {.title = NULL};
+
+/**
+ * @brief Bring the LCD to a menu frame with the fewest commands
+ *
+ * @param title Label of the menu, drawn when it is not the one shown
+ * @param labels Label of each row under the title, NULL for an empty row
+ * @param cursor Row of the cursor
+ */
+void menu_draw(const char *title, const char *labels[], uint8_t cursor) {
+  bool whole =
+      menu_screen.title != title || menu_screen.clears != display_clears();
+  bool moved = whole;
+
+  if (whole) {
+    display_cursor(false, 0, 0);
+    display_clear();
+    display_puts((CONFIG_HORIZONTAL_SIZE - strlen(title)) / 2, 0, title);
+    memset(menu_screen.rows, 0, sizeof(menu_screen.rows));
+    menu_screen.title = title;
+    menu_screen.clears = display_clears();
+  }
+
+  for (uint8_t row = 0; row < MENU_ROWS; row++) {
+    char label[MENU_LABEL_SIZE + 1];
+
+    // padded, so a shorter label covers the longer one it replaces
+    snprintf(label, sizeof(label), "%-*.*s", MENU_LABEL_SIZE, MENU_LABEL_SIZE,
+             labels[row] != NULL ? labels[row] : "");
+    if (strcmp(label, menu_screen.rows[row]) != 0) {
+      display_puts(MENU_LABEL_X, row + 1, label);
+      strcpy(menu_screen.rows[row], label);
+      moved = true;
+    }
+  }
+
+  if (whole || cursor != menu_screen.cursor) {
+    if (!whole) {
+      display_putc(0, menu_screen.cursor + 1, ' ');
+    }
+    display_putc(0, cursor + 1, '\x7E');
+    menu_screen.cursor = cursor;
+    moved = true;
+  }
+
+  if (moved) {
+    display_flush();
+  }
+}
+
+uint8_t first = 0;
 
 /**
  * @brief Show Menu Menager to LCD 2004
@@ -378,31 +556,27 @@ const char *old_title;
  * @param current_path Situation of Menu Menager
  */
 void displayNormal(menu_path_t *current_path) {
+  if (menu_steps != 0) {
+    return;
+  }
+
+  menu_node_t *menu = current_path->current_menu;
   uint8_t select = current_path->current_index;
-  uint8_t count = 1;
-  char *title = current_path->current_menu->label;
+  const char *labels[MENU_ROWS];
 
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, (CONFIG_HORIZONTAL_SIZE - strlen(title)) / 2, 0);
-  hd44780_puts(&lcd, title);
+  // the window follows the selection, and starts over in another menu
   if (select < first || select == 0) {
     first = select;
-    end = first + CONFIG_VERTICAL_SIZE - 1;
-  } else if (select + 1 > end || old_title != title) {
-    end = select + 1;
-    first = end - CONFIG_VERTICAL_SIZE + 1;
+  } else if (select >= first + MENU_ROWS || menu_screen.title != menu->label) {
+    first = select >= MENU_ROWS ? select - MENU_ROWS + 1 : 0;
   }
-  old_title = title;
-
-  for (uint8_t _ = first; _ < end; _++) {
-    hd44780_gotoxy(&lcd, 0, count);
-    count++;
-    if (_ == select) {
-      hd44780_puts(&lcd, "\x7E"
-                         " ");
-    }
-    hd44780_puts(&lcd, current_path->current_menu->submenus[_].label);
+
+  for (uint8_t row = 0; row < MENU_ROWS; row++) {
+    labels[row] = first + row < menu->num_options
+                      ? menu->submenus[first + row].label
+                      : NULL;
   }
+  menu_draw(menu->label, labels, select - first);
 }
 
 /**
@@ -411,31 +585,21 @@ void displayNormal(menu_path_t *current_path) {
  * @param current_path Situation of Menu Menager
  */
 void displayLoop(menu_path_t *current_path) {
-  hd44780_control(&lcd, true, false, false);
-
-  char *title = current_path->current_menu->label;
+  if (menu_steps != 0) {
+    return;
+  }
 
+  menu_node_t *menu = current_path->current_menu;
   uint8_t select = current_path->current_index;
-  uint8_t prev = (current_path->current_menu->num_options + select - 1) %
-                 current_path->current_menu->num_options;
-  uint8_t next = (select + 1) % current_path->current_menu->num_options;
-
-  const char *prev_label = current_path->current_menu->submenus[prev].label;
-  const char *select_label = current_path->current_menu->submenus[select].label;
-  const char *next_label = current_path->current_menu->submenus[next].label;
-
-  uint8_t central_title = (CONFIG_HORIZONTAL_SIZE - strlen(title)) / 2;
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, central_title, 0);
-  hd44780_puts(&lcd, title);
-  hd44780_gotoxy(&lcd, 0, 1);
-  hd44780_puts(&lcd, prev_label);
-  hd44780_gotoxy(&lcd, 0, 2);
-  hd44780_puts(&lcd, "\x7E"
-                     " ");
-  hd44780_puts(&lcd, select_label);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, next_label);
+  uint8_t prev = (menu->num_options + select - 1) % menu->num_options;
+  uint8_t next = (select + 1) % menu->num_options;
+
+  const char *labels[MENU_ROWS] = {
+      menu->submenus[prev].label,
+      menu->submenus[select].label,
+      menu->submenus[next].label,
+  };
+  menu_draw(menu->label, labels, 1);
 }
 
 // Experiments
@@ -444,260 +608,424 @@ void displayLoop(menu_path_t *current_path) {
  * in this stage
  * */
 
-/* A little using example of the pcnt to take timed:
- * https://github.com/MarcioBulla/Learning_ESP-IDF/blob/main/learning_pcnt/main/main.c
- */
+/* While timing, the display is refreshed by a tick instead of a timeout on
+ * the queues, so the experiment only wakes when something happens. */
+static void refresh_tick(void *args) {
+  if (tExperiment != NULL) {
+    xTaskNotify(tExperiment, EVENT_REFRESH, eSetBits);
+  }
+}
 
-pcnt_unit_config_t config_unit = {
-    .high_limit = 200,
-    .low_limit = -10,
-};
+esp_timer_handle_t refresh_timer = NULL;
 
-pcnt_chan_config_t config_chan = {
-    .edge_gpio_num = CONFIG_SENSOR_IR,
+esp_timer_create_args_t refresh_timer_args = {
+    .callback = refresh_tick,
+    .name = "refresh",
 };
 
-static bool cronos(pcnt_unit_handle_t pcnt_unit,
-                   const pcnt_watch_event_data_t *edata, void *user_ctx) {
-  time_t temp_time = esp_timer_get_time();
-  BaseType_t high_task_wakeup;
-  QueueHandle_t qPCNT = (QueueHandle_t)user_ctx;
-  xQueueSendFromISR(qPCNT, &temp_time, &high_task_wakeup);
-  return (high_task_wakeup == pdTRUE);
-};
+void refresh_start(void) {
+  esp_timer_start_periodic(refresh_timer, REFRESH_PERIOD_US);
+}
 
-pcnt_event_callbacks_t pcnt_event = {
-    .on_reach = cronos,
-};
+void refresh_stop(void) {
+  // fails when the timer is not running, and that is fine
+  esp_timer_stop(refresh_timer);
+}
 
-esp_err_t startPCNT(void) {
-  qPCNT = xQueueCreate(2, sizeof(time_t));
-  pcnt_new_unit(&config_unit, &pcnt_unit);
-  pcnt_new_channel(pcnt_unit, &config_chan, &pcnt_chan);
+/**
+ * @brief Block the experiment until a sensor event, a command or a refresh
+ *
+ * @return Bits of the events that woke the experiment
+ */
+uint32_t wait_events(void) {
+  uint32_t events = 0;
+  xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+  return events;
+}
 
-  pcnt_channel_set_edge_action(pcnt_chan, PCNT_CHANNEL_EDGE_ACTION_HOLD,
-                               PCNT_CHANNEL_EDGE_ACTION_HOLD);
+/* The polls of the experiments are esp_timer ticks too, not waits of ticks,
+ * so the host runs them on its virtual clock with the rest of the timers. */
+static void poll_tick(void *args) {
+  if (tExperiment != NULL) {
+    xTaskNotify(tExperiment, EVENT_POLL, eSetBits);
+  }
+}
 
-  pcnt_unit_register_event_callbacks(pcnt_unit, &pcnt_event, qPCNT);
+esp_timer_handle_t poll_timer = NULL;
 
-  ESP_ERROR_CHECK(pcnt_unit_enable(pcnt_unit));
+esp_timer_create_args_t poll_timer_args = {
+    .callback = poll_tick,
+    .name = "poll",
+};
 
-  return ESP_OK;
+static void poll_start(uint32_t ms) {
+  // fails when the timer is not running, and that is fine
+  esp_timer_stop(poll_timer);
+  // a tick that fired after the last poll ended
+  xTaskNotifyWait(EVENT_POLL, 0, NULL, 0);
+  esp_timer_start_once(poll_timer, (uint64_t)ms * 1000);
 }
 
-void pcnt_config_experiment(experiment_config_t config_experiment) {
-  ESP_ERROR_CHECK(pcnt_unit_disable(pcnt_unit));
+/**
+ * @brief Wait up to ms for a command of the experiment
+ *
+ * @return false when nothing came before
+ */
+static bool poll_command(rotary_encoder_event_t *e, uint32_t ms) {
+  poll_start(ms);
+  while (!input_receive(qCommand, e, 0)) {
+    if (wait_events() & EVENT_POLL) {
+      return false;
+    }
+  }
+  esp_timer_stop(poll_timer);
+  return true;
+}
 
-  ESP_ERROR_CHECK(pcnt_channel_set_edge_action(
-      pcnt_chan, config_experiment.rising, config_experiment.falling));
+/**
+ * @brief Sleep of the experiment, the events that come meanwhile stay queued
+ */
+static void poll_delay(uint32_t ms) {
+  poll_start(ms);
+  while (!(wait_events() & EVENT_POLL)) {
+  }
+}
 
-  ESP_ERROR_CHECK(
-      pcnt_unit_set_glitch_filter(pcnt_unit, &config_experiment.filter));
+esp_err_t startPCNT(void) {
+  qPCNT = xQueueCreate(2, sizeof(pcnt_stamp_t));
+  ESP_ERROR_CHECK(esp_timer_create(&refresh_timer_args, &refresh_timer));
+  ESP_ERROR_CHECK(esp_timer_create(&poll_timer_args, &poll_timer));
 
-  ESP_ERROR_CHECK(pcnt_unit_enable(pcnt_unit));
+  return timing_init();
+}
 
-  for (uint8_t i = 0; i < 2; i++) {
-    if (currentWatchers[i] > 0) {
-      ESP_ERROR_CHECK(
-          pcnt_unit_remove_watch_point(pcnt_unit, currentWatchers[i]));
-      ESP_LOGI(TAG, "Remove watch point: %" PRId32, currentWatchers[i]);
-    }
-    ESP_ERROR_CHECK(
-        pcnt_unit_add_watch_point(pcnt_unit, config_experiment.watchPoint[i]));
-    currentWatchers[i] = config_experiment.watchPoint[i];
-    ESP_LOGI(TAG, "Set watch point: %" PRId32, config_experiment.watchPoint[i]);
-  }
+void pcnt_config_experiment(experiment_config_t config_experiment) {
+  filter_apply(&config_experiment);
+  ESP_ERROR_CHECK(gate_config(0, &config_experiment));
 
-  ESP_ERROR_CHECK(pcnt_unit_clear_count(pcnt_unit));
+  stream_run_start(&config_experiment);
+  capture_start(&config_experiment);
 
-  ESP_ERROR_CHECK(pcnt_unit_start(pcnt_unit));
+  ESP_ERROR_CHECK(gate_start(0));
 }
 
 void print_config(void) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, "     !!Config!!      ");
-  xSemaphoreGive(sDisplay);
+  display_puts(0, 3, "     !!Config!!     ");
+  display_flush();
 }
 
 void print_waiting(void) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, "     !!Waiting!!     ");
-  xSemaphoreGive(sDisplay);
+  display_puts(0, 3, "     !!Waiting!!    ");
+  display_flush();
 }
 
 void print_timing(void) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, "     !!Timing!!     ");
-  xSemaphoreGive(sDisplay);
+  display_puts(0, 3, "     !!Timing!!     ");
+  display_flush();
 }
 
 void print_done(void) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, "      !!Done!!      ");
-  xSemaphoreGive(sDisplay);
+  display_puts(0, 3, "      !!Done!!      ");
+  display_flush();
 }
 
 void print_obstruct_error(void) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 0, 3);
-  hd44780_puts(&lcd, "!Obstructed  Sensor!");
-  xSemaphoreGive(sDisplay);
+  display_puts(0, 3, "!Obstructed  Sensor!");
+  display_flush();
 }
 
-void periods_to_string(uint8_t periods, char *string) {
-  string[0] = '0' + periods / 10;
-  string[1] = '0' + periods % 10;
-  string[2] = '\0';
+/**
+ * @brief Four digits of the periods, held between 0 and EXPERIMENT_MAX_PERIODS
+ */
+void periods_to_string(int64_t periods, char *string) {
+  if (periods < 0) {
+    periods = 0;
+  } else if (periods > EXPERIMENT_MAX_PERIODS) {
+    periods = EXPERIMENT_MAX_PERIODS;
+  }
+  for (int8_t i = 3; i >= 0; i--) {
+    string[i] = '0' + periods % 10;
+    periods /= 10;
+  }
+  string[4] = '\0';
 }
 
-void micro_to_second(time_t microsecond, char *string) {
-  double seconds = microsecond / 1000000.0;
-  unsigned int int_seconds = (unsigned int)seconds;
-  unsigned int milliseconds = (unsigned int)((seconds - int_seconds) * 1000);
-  unsigned int microseconds_part =
-      (unsigned int)(((seconds - int_seconds) * 1000 - milliseconds) * 1000);
-  snprintf(string, 12, "%03d,%03d %03d", int_seconds, milliseconds,
-           microseconds_part);
+void update_periods(char *current_periods_str) {
+  display_puts(11, 1, current_periods_str);
+  display_flush();
 }
 
-void update_periods(char *current_periods_str) {
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 12, 1);
-  hd44780_puts(&lcd, current_periods_str);
-  xSemaphoreGive(sDisplay);
+/**
+ * @brief Periods moved by the encoder, a step is one period up to 100, then
+ * 10 up to 1000 and 100 after, so thousands are a few turns away
+ */
+uint16_t step_periods(uint16_t periods, int32_t diff) {
+  int32_t scale = periods >= 1000 ? 100 : periods >= 100 ? 10 : 1;
+
+  return input_step(periods, diff * scale, 1, EXPERIMENT_MAX_PERIODS);
 }
 
+time_odometer_t odometer;
+
+/**
+ * @brief Draws the running time, only the digits that changed are sent
+ */
 void update_time(time_t first, time_t lest) {
-  char time_str[12];
-  micro_to_second(lest - first, time_str);
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 5, 2);
-  hd44780_puts(&lcd, time_str);
-  hd44780_putc(&lcd, 's');
-  xSemaphoreGive(sDisplay);
+  bool stale = odometer.stale;
+  uint8_t changed = time_odometer_update(&odometer, lest - first);
+
+  if (changed < TIME_FORMAT_LEN) {
+    display_puts(5 + changed, 2, odometer.text + changed);
+  }
+  if (stale) {
+    display_putc(16, 2, 's');
+  }
+  display_flush();
 }
 
 bool back_to_config(rotary_encoder_event_type_t event) {
   if (event == RE_ET_BTN_CLICKED) {
     ESP_LOGI(TAG, "Return To Config");
 
-    pcnt_unit_stop(pcnt_unit);
+    gate_stop(0);
+    capture_stop();
     update_time(0, 0);
     event = RE_ET_BTN_RELEASED;
 
-    vTaskDelete(tHourglass);
-    tHourglass = NULL;
+    hourglass_stop();
 
     if (tCheckSensor != NULL) {
       vTaskDelete(tCheckSensor);
       tCheckSensor = NULL;
     }
 
-    hd44780_gotoxy(&lcd, H_POSITION_HOURGLASS, V_POSITION_HOURGLASS);
-    hd44780_putc(&lcd, 7);
-
     return true;
   }
   return false;
 }
 
+/**
+ * @brief Next command for the experiment, a run queued from the console is
+ * taken as a click
+ *
+ * @param param Receives the parameter of the run in the config stage, NULL in
+ * the done stage
+ */
+void receive_command(experiment_kind_t kind, rotary_encoder_event_t *e,
+                     uint16_t *param) {
+  if (param != NULL ? console_take_run(kind, param) : console_pending(kind)) {
+    e->type = RE_ET_BTN_CLICKED;
+    return;
+  }
+  input_receive(qCommand, e, portMAX_DELAY);
+}
+
+edge_run_t run;
+period_fit_t fit;
+damping_t damping;
+
+/* The sinks of the run, the fits take every edge as it is drained and not
+ * only the ones the run keeps. */
+static void fit_edges(const edge_event_t *events, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    period_fit_add(&fit, &events[i]);
+  }
+}
+
+static void fit_damped_edges(const edge_event_t *events, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    period_fit_add(&fit, &events[i]);
+    damping_add(&damping, &events[i]);
+  }
+}
+
+/**
+ * @brief Shows the fitted period, the result becomes the fitted run time
+ * with the error of the period, in the fit mode
+ *
+ * With less than 3 edges the result stays the time between the watch points.
+ */
+void print_fit(uint16_t periods, experiment_data_t *data) {
+  double period, error;
+  char timed[TIME_FORMAT_LEN + 1];
+  char string[32];
+
+  if (!period_fit_result(&fit, &period, &error)) {
+    return;
+  }
+
+  data->timed = llround(period * periods / 1000);
+  data->mode = RESULT_FIT;
+  data->fit_error_ns = error < UINT32_MAX ? llround(error) : UINT32_MAX;
+
+  uint32_t error_us = ceil(error / 1000);
+  if (error_us > 999) {
+    error_us = 999;
+  }
+  time_format(llround(period / 1000), timed);
+  snprintf(string, 32, "T%s +-%" PRIu32 "us    ", timed, error_us);
+  display_puts(0, 3, string);
+  display_flush();
+}
+
+/**
+ * @brief Drain the edges left in the capture ring and log every period
+ *
+ * @param run Edges of the run that just finished
+ * @param edges_per_period Qualifying edges that make one period
+ */
+void log_run(edge_run_t *run, uint8_t edges_per_period) {
+  const edge_event_t *previous = NULL;
+
+  capture_drain(run);
+
+  for (size_t i = 0; i < run->size; i++) {
+    const edge_event_t *edge = &run->events[i];
+    if (!edge->counted || (edge->count - 1) % edges_per_period != 0) {
+      continue;
+    }
+    if (previous != NULL) {
+      ESP_LOGI(TAG, "Period %02" PRIu32 ": %" PRId64 " us",
+               (edge->count - 1) / edges_per_period,
+               (edge->time - previous->time) / 1000);
+    }
+    previous = edge;
+  }
+
+  ESP_LOGI(TAG, "Edges: %zu, Dropped: %" PRIu32 ", Overruns: %" PRIu32,
+           run->size, run->dropped, capture_overruns());
+}
+
 // Config Experiment Pendulum
+void print_pendulum(void) {
+  display_clear();
+  display_puts(6, 0, "Pendulum");
+  display_puts(0, 1, "Periods: n\x03"
+                     "0000/0000");
+  display_putc(H_POSITION_HOURGLASS, V_POSITION_HOURGLASS, 7);
+
+  time_odometer_reset(&odometer);
+  update_time(0, 0);
+}
+
+/**
+ * @brief Damping coefficient, drift and three periods from the first row
+ */
+void print_damping(uint8_t first_row) {
+  damping_row_t row;
+  double gamma, drift, error;
+  char timed[TIME_FORMAT_LEN + 1];
+  char string[32];
+
+  if (!damping_coefficient(&damping, &gamma, &error)) {
+    gamma = NAN;
+  }
+  if (!damping_drift(&damping, &drift, &error)) {
+    drift = NAN;
+  }
+  snprintf(string, 32, "g%7.4f/s dT%+5.1fus", gamma, drift);
+  display_puts(0, 0, string);
+
+  for (uint8_t line = 1; line < 4; line++) {
+    uint8_t period = first_row + line;
+
+    if (period > damping_periods(&damping)) {
+      display_clear_line(line);
+      continue;
+    }
+
+    damping_row(&damping, period, &row);
+    time_format(row.period, timed);
+    uint32_t transit = row.transit[0] > 99999 ? 99999 : row.transit[0];
+    snprintf(string, 32, "%02u %s%6" PRIu32, period, timed, transit);
+    display_puts(0, line, string);
+  }
+  display_flush();
+}
+
 void Pendulum(void *args) {
   rotary_encoder_event_t e;
   experiment_data_t data;
-  int count = 0;
-  uint8_t set_periods = CONFIG_PENDULUM;
-  char set_periods_str[3];
-  char current_periods_str[3];
+  int64_t count = 0;
+  uint16_t set_periods = CONFIG_PENDULUM;
+  char set_periods_str[5];
+  char current_periods_str[5];
   time_t first = 0, lest = 0;
-  time_t time;
+  int64_t timed;
+  pcnt_stamp_t stamps[2];
   experiment_stage_t stage = EXPERIMENT_CONFIG;
   experiment_config_t config = {
       .rising = PCNT_CHANNEL_EDGE_ACTION_INCREASE,
       .falling = PCNT_CHANNEL_EDGE_ACTION_HOLD,
-      .filter = {.max_glitch_ns = 100},
       .watchPoint[0] = 1,
   };
 
   periods_to_string(set_periods, set_periods_str);
 
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, 6, 0);
-  hd44780_puts(&lcd, "Pendulum");
-  hd44780_gotoxy(&lcd, 1, 1);
-  hd44780_puts(&lcd, "Periods: n\x03"
-                     "00/n\x03");
-  hd44780_gotoxy(&lcd, H_POSITION_HOURGLASS, V_POSITION_HOURGLASS);
-  hd44780_putc(&lcd, 7);
-  xSemaphoreGive(sDisplay);
+  print_pendulum();
 
-  update_time(first, lest);
+  // a calibration of the filter might be sampling the sensor
+  gate_take(0, portMAX_DELAY);
+  tExperiment = xTaskGetCurrentTaskHandle();
+  gate_subscribe(GATE_BIT(0), qPCNT, tExperiment, EVENT_SENSOR);
+  console_attach(EXPERIMENT_PENDULUM);
+  xTaskNotifyStateClear(NULL);
 
   while (true) {
 
     xQueueReset(qPCNT);
-    update_periods("00");
+    run.size = 0;
+    run.dropped = 0;
+    run.sink = fit_damped_edges;
+    update_periods("0000");
     print_config();
     stage = EXPERIMENT_CONFIG;
 
-    hd44780_control(&lcd, true, false, true);
+    display_cursor(true, 15, 1);
 
     while (stage == EXPERIMENT_CONFIG) {
-      xSemaphoreTake(sDisplay, portMAX_DELAY);
       periods_to_string(set_periods, set_periods_str);
-      hd44780_gotoxy(&lcd, 17, 1);
-      hd44780_puts(&lcd, set_periods_str);
-      hd44780_gotoxy(&lcd, 16, 1);
-      xSemaphoreGive(sDisplay);
+      display_puts(16, 1, set_periods_str);
+      display_flush();
 
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
+      receive_command(EXPERIMENT_PENDULUM, &e, &set_periods);
 
       if (e.type == RE_ET_CHANGED) {
-        if (e.diff > 0) {
-          if (set_periods < 99)
-            set_periods++;
-        } else {
-          if (set_periods > 1)
-            set_periods--;
-        }
+        set_periods = step_periods(set_periods, e.diff);
       } else if (e.type == RE_ET_BTN_CLICKED) {
         e.type = RE_ET_BTN_RELEASED;
-        hd44780_control(&lcd, true, false, false);
+        display_cursor(false, 0, 0);
 
-        if (gpio_get_level(CONFIG_SENSOR_IR)) {
+        if (gate_level(0)) {
           stage = EXPERIMENT_ERROR;
         } else {
           stage = EXPERIMENT_WAITTING;
         }
 
-        snprintf(data.option, 8, "Pen%02d", set_periods);
+        data.kind = EXPERIMENT_PENDULUM;
+        data.param = set_periods;
 
+        periods_to_string(set_periods, set_periods_str);
         config.watchPoint[1] = 2 * set_periods + 1;
-        xTaskCreatePinnedToCore(&HourGlass_animation, "HourGlass Animation",
-                                2048, NULL, 1, &tHourglass, 0);
+        config.all_edges = damping_mode;
+        period_fit_reset(&fit, config.watchPoint, 2);
+        damping_reset(&damping, config.watchPoint);
+        hourglass_start();
       }
     }
 
     while (stage == EXPERIMENT_ERROR) {
-      xSemaphoreTake(sDisplay, portMAX_DELAY);
-      hd44780_gotoxy(&lcd, 0, 3);
-      hd44780_puts(&lcd, "!Obstructed  Sensor!");
-      xSemaphoreGive(sDisplay);
+      print_obstruct_error();
 
       for (uint8_t i = 0; i < 5; i++) {
 
-        if (xQueueReceive(qCommand, &e, 20) == pdTRUE) {
+        if (poll_command(&e, 20 * portTICK_PERIOD_MS)) {
           if (back_to_config(e.type)) {
             stage = EXPERIMENT_CONFIG;
           }
         }
 
-        if (gpio_get_level(CONFIG_SENSOR_IR)) {
+        if (gate_level(0)) {
           stage = EXPERIMENT_ERROR;
           i = 0;
         } else {
@@ -711,49 +1039,85 @@ void Pendulum(void *args) {
     pcnt_config_experiment(config);
 
     while (stage == EXPERIMENT_WAITTING) {
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
-        first = time;
+      if (xQueueReceive(qPCNT, &stamps[0], 0) == pdTRUE) {
+        first = stamps[0].time;
         stage = EXPERIMENT_TIMING;
         print_timing();
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else {
+        wait_events();
       }
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
-
-      pcnt_unit_get_count(pcnt_unit, &count);
     }
 
+    refresh_start();
     while (stage == EXPERIMENT_TIMING) {
-      pcnt_unit_get_count(pcnt_unit, &count);
-      periods_to_string((count - 1) / 2, current_periods_str);
-
-      lest = esp_timer_get_time() + esp_random() % 10000;
-
-      update_time(first, lest);
-      update_periods(current_periods_str);
-
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
+      if (xQueueReceive(qPCNT, &stamps[1], 0) == pdTRUE) {
         stage = EXPERIMENT_DONE;
 
         print_done();
 
-        lest = time;
+        lest = stamps[1].time;
+        capture_stop();
+        capture_drain(&run);
+        latency_record_run(&run, config.watchPoint, stamps);
+        timed = lest - first;
+        capture_latched_timed(&run, config.watchPoint, &timed);
+        data.timed = timed;
+        data.mode = RESULT_TWO_EDGES;
+        data.fit_error_ns = 0;
+        if (result_mode == RESULT_FIT) {
+          print_fit(set_periods, &data);
+        }
         update_periods(set_periods_str);
-        update_time(first, lest);
-        micro_to_second(lest - first, data.timed);
+        update_time(0, data.timed);
         append_history(data);
-      }
+        stream_run_end(&data);
+        console_run_done(&data);
+        log_run(&run, 2);
+        if (damping_mode) {
+          damping_dump(&damping);
+        }
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else if (wait_events() & EVENT_REFRESH) {
+        capture_drain(&run);
+        count = gate_count(0);
+        periods_to_string((count - 1) / 2, current_periods_str);
 
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
+        lest = esp_timer_get_time() + esp_random() % 10000;
+
+        update_time(first, lest);
+        update_periods(current_periods_str);
+      }
     }
+    refresh_stop();
+
+    // the encoder scrolls the breakdown of the periods
+    bool breakdown = false;
+    uint8_t first_row = 0;
 
     while (stage == EXPERIMENT_DONE) {
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
-      if (back_to_config(e.type))
+      receive_command(EXPERIMENT_PENDULUM, &e, NULL);
+      if (damping_mode && e.type == RE_ET_CHANGED) {
+        if (!breakdown) {
+          hourglass_stop();
+          breakdown = true;
+        } else {
+          int32_t last_row = damping_periods(&damping) - 3;
+          first_row =
+              input_step(first_row, e.diff, 0, last_row > 0 ? last_row : 0);
+        }
+        print_damping(first_row);
+      } else if (back_to_config(e.type)) {
         stage = EXPERIMENT_CONFIG;
-      vTaskDelay(pdMS_TO_TICKS(10));
+        if (breakdown) {
+          print_pendulum();
+        }
+      }
+      poll_delay(10);
     }
   }
 }
@@ -761,118 +1125,134 @@ void Pendulum(void *args) {
 void Spring(void *args) {
   rotary_encoder_event_t e;
   experiment_data_t data;
-  int count = 0;
-  uint8_t set_periods = CONFIG_SPRING;
-  char set_periods_str[3];
-  char current_periods_str[3];
+  int64_t count = 0;
+  uint16_t set_periods = CONFIG_SPRING;
+  char set_periods_str[5];
+  char current_periods_str[5];
   time_t first = 0, lest = 0;
-  time_t time;
+  int64_t timed;
+  pcnt_stamp_t stamps[2];
   experiment_stage_t stage = EXPERIMENT_CONFIG;
   experiment_config_t config = {
       .rising = PCNT_CHANNEL_EDGE_ACTION_HOLD,
       .falling = PCNT_CHANNEL_EDGE_ACTION_INCREASE,
-      .filter = {.max_glitch_ns = 100},
       .watchPoint[0] = 1,
   };
 
   periods_to_string(set_periods, set_periods_str);
 
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, 7, 0);
-  hd44780_puts(&lcd, "Spring");
-  hd44780_gotoxy(&lcd, 1, 1);
-  hd44780_puts(&lcd, "Periods: n\x03"
-                     "00/n\x03");
-  hd44780_gotoxy(&lcd, H_POSITION_HOURGLASS, V_POSITION_HOURGLASS);
-  hd44780_putc(&lcd, 7);
-  xSemaphoreGive(sDisplay);
+  display_clear();
+  display_puts(7, 0, "Spring");
+  display_puts(0, 1, "Periods: n\x03"
+                     "0000/0000");
+  display_putc(H_POSITION_HOURGLASS, V_POSITION_HOURGLASS, 7);
 
+  time_odometer_reset(&odometer);
   update_time(first, lest);
 
+  // a calibration of the filter might be sampling the sensor
+  gate_take(0, portMAX_DELAY);
+  tExperiment = xTaskGetCurrentTaskHandle();
+  gate_subscribe(GATE_BIT(0), qPCNT, tExperiment, EVENT_SENSOR);
+  console_attach(EXPERIMENT_SPRING);
+  xTaskNotifyStateClear(NULL);
+
   while (true) {
 
     xQueueReset(qPCNT);
-    update_periods("00");
+    run.size = 0;
+    run.dropped = 0;
+    run.sink = fit_edges;
+    update_periods("0000");
     print_config();
     stage = EXPERIMENT_CONFIG;
-    hd44780_control(&lcd, true, false, true);
+    display_cursor(true, 15, 1);
 
     while (stage == EXPERIMENT_CONFIG) {
-      xSemaphoreTake(sDisplay, portMAX_DELAY);
       periods_to_string(set_periods, set_periods_str);
-      hd44780_gotoxy(&lcd, 17, 1);
-      hd44780_puts(&lcd, set_periods_str);
-      hd44780_gotoxy(&lcd, 16, 1);
-      xSemaphoreGive(sDisplay);
+      display_puts(16, 1, set_periods_str);
+      display_flush();
 
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
+      receive_command(EXPERIMENT_SPRING, &e, &set_periods);
 
       if (e.type == RE_ET_CHANGED) {
-        if (e.diff > 0) {
-          if (set_periods < 99)
-            set_periods++;
-        } else {
-          if (set_periods > 1)
-            set_periods--;
-        }
+        set_periods = step_periods(set_periods, e.diff);
       } else if (e.type == RE_ET_BTN_CLICKED) {
         e.type = RE_ET_BTN_RELEASED;
         stage = EXPERIMENT_WAITTING;
 
-        hd44780_control(&lcd, true, false, false);
+        display_cursor(false, 0, 0);
+        periods_to_string(set_periods, set_periods_str);
         config.watchPoint[1] = set_periods + 1;
+        period_fit_reset(&fit, config.watchPoint, 1);
 
-        snprintf(data.option, 8, "Spr%02d", set_periods);
+        data.kind = EXPERIMENT_SPRING;
+        data.param = set_periods;
 
         pcnt_config_experiment(config);
 
         print_waiting();
 
-        xTaskCreatePinnedToCore(&HourGlass_animation, "HourGlass Animation",
-                                2048, NULL, 1, &tHourglass, 0);
+        hourglass_start();
       }
     }
 
     while (stage == EXPERIMENT_WAITTING) {
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
-        first = time;
+      if (xQueueReceive(qPCNT, &stamps[0], 0) == pdTRUE) {
+        first = stamps[0].time;
         stage = EXPERIMENT_TIMING;
         print_timing();
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else {
+        wait_events();
       }
     }
 
+    refresh_start();
     while (stage == EXPERIMENT_TIMING) {
-      pcnt_unit_get_count(pcnt_unit, &count);
-      periods_to_string((count - 1), current_periods_str);
-
-      lest = esp_timer_get_time() + esp_random() % 10000;
-
-      update_time(first, lest);
-      update_periods(current_periods_str);
-
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
+      if (xQueueReceive(qPCNT, &stamps[1], 0) == pdTRUE) {
         stage = EXPERIMENT_DONE;
 
         print_done();
 
-        lest = time;
+        lest = stamps[1].time;
+        capture_stop();
+        capture_drain(&run);
+        latency_record_run(&run, config.watchPoint, stamps);
+        timed = lest - first;
+        capture_latched_timed(&run, config.watchPoint, &timed);
+        data.timed = timed;
+        data.mode = RESULT_TWO_EDGES;
+        data.fit_error_ns = 0;
+        if (result_mode == RESULT_FIT) {
+          print_fit(set_periods, &data);
+        }
         update_periods(set_periods_str);
-        update_time(first, lest);
-
-        micro_to_second(lest - first, data.timed);
+        update_time(0, data.timed);
         append_history(data);
+        stream_run_end(&data);
+        console_run_done(&data);
+        log_run(&run, 1);
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else if (wait_events() & EVENT_REFRESH) {
+        capture_drain(&run);
+        count = gate_count(0);
+        periods_to_string((count - 1), current_periods_str);
+
+        lest = esp_timer_get_time() + esp_random() % 10000;
+
+        update_time(first, lest);
+        update_periods(current_periods_str);
       }
     }
+    refresh_stop();
 
     while (stage == EXPERIMENT_DONE) {
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
+      receive_command(EXPERIMENT_SPRING, &e, NULL);
       if (back_to_config(e.type))
         stage = EXPERIMENT_CONFIG;
     }
@@ -912,8 +1292,7 @@ void select_shape_energy(energy_t select, experiment_config_t *exp_config) {
   }
 }
 
-void print_shape_energy(energy_t selecte, char string[6]) {
-  ESP_LOGI(TAG, "SHAPE: %d", selecte);
+void shape_energy_to_string(energy_t selecte, char string[6]) {
   switch (selecte) {
 
   case ENERGY_SOLID:
@@ -932,92 +1311,96 @@ void print_shape_energy(energy_t selecte, char string[6]) {
     strncpy(string, "2R\x01  ", 6);
     break;
   }
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_gotoxy(&lcd, 8, 1);
-  hd44780_puts(&lcd, string);
-  hd44780_gotoxy(&lcd, 7, 1);
-  xSemaphoreGive(sDisplay);
+}
+
+void print_shape_energy(energy_t selecte) {
+  char string[6];
+
+  ESP_LOGI(TAG, "SHAPE: %d", selecte);
+  shape_energy_to_string(selecte, string);
+  display_puts(8, 1, string);
+  display_flush();
 }
 
 void Energy(void *args) {
   rotary_encoder_event_t e;
   energy_t set_shape = (energy_t)CONFIG_ENERGY;
   time_t first = 0, lest = 0;
-  time_t time;
+  int64_t timed;
+  pcnt_stamp_t stamps[2];
   experiment_data_t data;
   experiment_stage_t stage = EXPERIMENT_CONFIG;
-  experiment_config_t config = {
-      .filter = {.max_glitch_ns = 100},
-  };
+  // select_shape_energy() sets the edges and watch points of the shape
+  experiment_config_t config = {0};
+
+  display_clear();
+  display_puts(1, 0, "Mechanical  Energy");
+  display_puts(1, 1, "Shape: ");
 
-  xSemaphoreTake(sDisplay, portMAX_DELAY);
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, 1, 0);
-  hd44780_puts(&lcd, "Mechanical  Energy");
-  hd44780_gotoxy(&lcd, 1, 1);
-  hd44780_puts(&lcd, "Shape: ");
-  xSemaphoreGive(sDisplay);
-
-  print_shape_energy(set_shape, data.option);
-  hd44780_gotoxy(&lcd, H_POSITION_HOURGLASS, V_POSITION_HOURGLASS);
-  hd44780_putc(&lcd, 7);
+  display_putc(H_POSITION_HOURGLASS, V_POSITION_HOURGLASS, 7);
+  print_shape_energy(set_shape);
+  time_odometer_reset(&odometer);
   update_time(first, lest);
 
+  // a calibration of the filter might be sampling the sensor
+  gate_take(0, portMAX_DELAY);
+  tExperiment = xTaskGetCurrentTaskHandle();
+  gate_subscribe(GATE_BIT(0), qPCNT, tExperiment, EVENT_SENSOR);
+  console_attach(EXPERIMENT_ENERGY);
+  xTaskNotifyStateClear(NULL);
+
   while (true) {
 
     xQueueReset(qPCNT);
+    run.size = 0;
+    run.dropped = 0;
+    run.sink = NULL;
     print_config();
     stage = EXPERIMENT_CONFIG;
-    hd44780_control(&lcd, true, false, true);
+    display_cursor(true, 7, 1);
 
     while (stage == EXPERIMENT_CONFIG) {
-      print_shape_energy(set_shape, data.option);
+      print_shape_energy(set_shape);
 
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
+      uint16_t shape = set_shape;
+      receive_command(EXPERIMENT_ENERGY, &e, &shape);
+      set_shape = shape;
 
       if (e.type == RE_ET_CHANGED) {
-        if (e.diff > 0) {
-          if (set_shape < 3)
-            set_shape++;
-        } else {
-          if (set_shape > 0)
-            set_shape--;
-        }
+        set_shape = input_step(set_shape, e.diff, 0, 3);
       } else if (e.type == RE_ET_BTN_CLICKED) {
         e.type = RE_ET_BTN_RELEASED;
-        if (gpio_get_level(CONFIG_SENSOR_IR)) {
+        if (gate_level(0)) {
           stage = EXPERIMENT_ERROR;
         } else {
           stage = EXPERIMENT_WAITTING;
         }
-        hd44780_control(&lcd, true, false, false);
-        xTaskCreatePinnedToCore(&HourGlass_animation, "HourGlass Animation",
-                                2048, NULL, 1, &tHourglass, 0);
+        display_cursor(false, 0, 0);
+        hourglass_start();
 
+        data.kind = EXPERIMENT_ENERGY;
+        data.param = set_shape;
         select_shape_energy(set_shape, &config);
       }
     }
 
     while (stage == EXPERIMENT_ERROR) {
-      xSemaphoreTake(sDisplay, portMAX_DELAY);
-      hd44780_gotoxy(&lcd, 0, 3);
-      hd44780_puts(&lcd, "!Obstructed  Sensor!");
-      xSemaphoreGive(sDisplay);
+      print_obstruct_error();
 
-      if (gpio_get_level(CONFIG_SENSOR_IR) == 0) {
+      if (gate_level(0) == 0) {
         stage = EXPERIMENT_WAITTING;
         ESP_LOGI(TAG, "Free Sensor");
       }
 
-      if (xQueueReceive(qCommand, &e, 25) == pdTRUE) {
+      if (poll_command(&e, 25 * portTICK_PERIOD_MS)) {
         if (back_to_config(e.type)) {
           stage = EXPERIMENT_CONFIG;
         }
       }
 
       if (stage == EXPERIMENT_WAITTING) {
-        vTaskDelay(pdMS_TO_TICKS(200));
-        if (gpio_get_level(CONFIG_SENSOR_IR)) {
+        poll_delay(200);
+        if (gate_level(0)) {
           stage = EXPERIMENT_ERROR;
           ESP_LOGI(TAG, "Obtructed Again");
         }
@@ -1029,99 +1412,130 @@ void Energy(void *args) {
     pcnt_config_experiment(config);
 
     while (stage == EXPERIMENT_WAITTING) {
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
-        first = time;
+      if (xQueueReceive(qPCNT, &stamps[0], 0) == pdTRUE) {
+        first = stamps[0].time;
         stage = EXPERIMENT_TIMING;
         print_timing();
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else {
+        wait_events();
       }
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
     }
 
+    refresh_start();
     while (stage == EXPERIMENT_TIMING) {
-      lest = esp_timer_get_time() + esp_random() % 10000;
-
-      update_time(first, lest);
-
-      xQueueReceive(qCommand, &e, 0);
-      if (back_to_config(e.type))
-        stage = EXPERIMENT_CONFIG;
-      if (xQueueReceive(qPCNT, &time, pdMS_TO_TICKS(40)) == pdTRUE) {
+      if (xQueueReceive(qPCNT, &stamps[1], 0) == pdTRUE) {
         stage = EXPERIMENT_DONE;
 
         print_done();
 
-        lest = time;
-        update_time(first, lest);
+        lest = stamps[1].time;
+        capture_stop();
+        capture_drain(&run);
+        latency_record_run(&run, config.watchPoint, stamps);
+        timed = lest - first;
+        capture_latched_timed(&run, config.watchPoint, &timed);
+        data.timed = timed;
+        data.mode = RESULT_TWO_EDGES;
+        data.fit_error_ns = 0;
+
+        update_time(0, data.timed);
 
-        micro_to_second(lest - first, data.timed);
         append_history(data);
+        stream_run_end(&data);
+        console_run_done(&data);
+        log_run(&run, 1);
+      } else if (input_receive(qCommand, &e, 0) == pdTRUE) {
+        if (back_to_config(e.type))
+          stage = EXPERIMENT_CONFIG;
+      } else if (wait_events() & EVENT_REFRESH) {
+        capture_drain(&run);
+        lest = esp_timer_get_time() + esp_random() % 10000;
+
+        update_time(first, lest);
       }
     }
+    refresh_stop();
 
     while (stage == EXPERIMENT_DONE) {
 
-      xQueueReceive(qCommand, &e, portMAX_DELAY);
+      receive_command(EXPERIMENT_ENERGY, &e, NULL);
       if (back_to_config(e.type))
         stage = EXPERIMENT_CONFIG;
     }
   }
 }
 
-experiment_data_t data_history[99];
-experiment_data_array_t history = {
-    .size = 0,
-    .capability = 100,
-    .array = data_history,
-};
+/* The name is cut so the periods fit: Pen05, Pe123, P1234. */
+static void periods_name(const char *name, uint16_t periods, char string[6]) {
+  int digits = periods < 100 ? 2 : periods < 1000 ? 3 : 4;
 
-void append_history(experiment_data_t data) {
-  if (history.size < history.capability) {
-    history.array[history.size] = data;
-    history.size++;
-  } else {
-    for (size_t i = 0; i < history.capability; i++) {
-      history.array[i] = history.array[i + 1];
-    }
-    history.array[history.size] = data;
-  }
+  snprintf(string, 6, "%.*s%0*u", 5 - digits, name, digits, periods);
 }
-void remove_at_history(size_t index) {
-  for (size_t i = index; i < history.size - 1; i++) {
-    history.array[i] = history.array[i + 1];
-  }
 
-  history.size--;
+/**
+ * @brief Text of the type of experiment, made only when it is shown
+ *
+ * @param data Result of the experiment
+ * @param string Text with 5 characters
+ */
+void experiment_to_string(const experiment_data_t *data, char string[6]) {
+  switch (data->kind) {
+
+  case EXPERIMENT_PENDULUM:
+    periods_name("Pen", data->param, string);
+    break;
+
+  case EXPERIMENT_SPRING:
+    periods_name("Spr", data->param, string);
+    break;
+
+  case EXPERIMENT_ENERGY:
+    shape_energy_to_string(data->param, string);
+    break;
+
+  default:
+    strncpy(string, "?????", 6);
+  }
 }
 
 void print_hist_data(size_t index, uint8_t line) {
-  char string[23];
-  snprintf(string, 23, "%02d|%s|%s", index, history.array[index].timed,
-           history.array[index].option);
+  experiment_data_t data;
+  char timed[12];
+  char option[6];
+  char string[32];
+
+  if (!history_at(index, &data)) {
+    snprintf(string, 32, "%02zu|  unreadable  ", index);
+    display_puts(0, line, string);
+    return;
+  }
+
+  time_format(data.timed, timed);
+  experiment_to_string(&data, option);
+  // after 100 results the index grows and the type is cut
+  snprintf(string, 32, "%02zu|%s|%s", index, timed, option);
 
-  hd44780_gotoxy(&lcd, 0, line);
-  hd44780_puts(&lcd, string);
-  hd44780_gotoxy(&lcd, 0, line);
+  display_puts(0, line, string);
 }
 
 void History(void *args) {
   rotary_encoder_event_t e;
-  uint8_t select_hist = 0;
+  size_t select_hist = 0;
   uint8_t count;
   uint8_t cursor_position = 0;
-  uint8_t first_hist = 0, end_hist = 0;
+  size_t first_hist = 0, end_hist = 0;
 
-  hd44780_clear(&lcd);
-  hd44780_puts(&lcd, "n\x03"
+  display_clear();
+  display_puts(0, 0, "n\x03"
                      "|Timed(s)   |Type");
 
-  hd44780_control(&lcd, true, false, true);
+  while (history_size() > 0) {
 
-  while (history.size > 0) {
-
-    if (select_hist >= history.size) {
-      select_hist = history.size - 1;
+    if (select_hist >= history_size()) {
+      select_hist = history_size() - 1;
     }
     if (select_hist <= first_hist) {
       first_hist = select_hist;
@@ -1130,53 +1544,116 @@ void History(void *args) {
       end_hist = select_hist;
       first_hist = end_hist - CONFIG_VERTICAL_SIZE + 2;
     }
-    ESP_LOGI(TAG, "\n First: %02d\n Select: %02d\n End: %02d", first_hist,
+    ESP_LOGI(TAG, "\n First: %02zu\n Select: %02zu\n End: %02zu", first_hist,
              select_hist, end_hist);
     count = 1;
 
-    for (uint8_t _ = first_hist; _ <= end_hist; _++) {
-      if (_ < history.size) {
+    for (size_t _ = first_hist; _ <= end_hist; _++) {
+      if (_ < history_size()) {
         print_hist_data(_, count);
         if (_ == select_hist) {
           cursor_position = count;
         }
       } else {
-        hd44780_clear_line(&lcd, count);
+        display_clear_line(count);
       }
 
       count++;
     }
 
-    hd44780_gotoxy(&lcd, 0, cursor_position);
+    display_cursor(true, 0, cursor_position);
+    display_flush();
 
-    xQueueReceive(qCommand, &e, portMAX_DELAY);
+    input_receive(qCommand, &e, portMAX_DELAY);
 
     if (e.type == RE_ET_CHANGED) {
-      if (e.diff > 0) {
-        if (select_hist < history.size - 1)
-          select_hist++;
-      } else if (select_hist > 0)
-        select_hist--;
+      select_hist = input_step(select_hist, e.diff, 0, history_size() - 1);
     } else if (e.type == RE_ET_BTN_CLICKED) {
-      hd44780_control(&lcd, true, false, false);
-      hd44780_gotoxy(&lcd, 0, cursor_position);
-      hd44780_puts(&lcd, "Two Clicks to Remove");
+      display_cursor(false, 0, 0);
+      display_puts(0, cursor_position, "Two Clicks to Remove");
+      display_flush();
       e.type = RE_BTN_RELEASED;
-      xQueueReceive(qCommand, &e, pdMS_TO_TICKS(3000));
+      input_receive(qCommand, &e, pdMS_TO_TICKS(3000));
       if (e.type == RE_ET_BTN_CLICKED) {
         remove_at_history(select_hist);
       }
-      hd44780_control(&lcd, true, false, true);
     }
   }
 
-  hd44780_control(&lcd, true, false, false);
+  display_cursor(false, 0, 0);
 
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, 9, 1);
-  hd44780_puts(&lcd, "no");
-  hd44780_gotoxy(&lcd, 6, 2);
-  hd44780_puts(&lcd, "readings");
+  display_clear();
+  display_puts(9, 1, "no");
+  display_puts(6, 2, "readings");
+  display_flush();
+
+  END_MENU_FUNCTION;
+}
+
+void print_stats_time(uint8_t line, const char *label, double microsecond) {
+  char timed[TIME_FORMAT_LEN + 1];
+  char string[21];
+
+  time_format((int64_t)(microsecond + 0.5), timed);
+  snprintf(string, 21, "%s%s s  ", label, timed);
+  display_puts(0, line, string);
+}
+
+void print_stats(size_t index, uint8_t page) {
+  stats_entry_t entry;
+  experiment_data_t data;
+  char option[6];
+  char string[32];
+
+  if (!stats_get(index, &entry)) {
+    return;
+  }
+
+  data.kind = entry.kind;
+  data.param = entry.param;
+  experiment_to_string(&data, option);
+  // f for the results of the fit
+  snprintf(string, 32, "%s%c n=%-6" PRIu32 "%2zu/%-2zu", option,
+           entry.mode == RESULT_FIT ? 'f' : ' ', entry.count, index + 1,
+           stats_size());
+  display_puts(0, 0, string);
+
+  if (page == 0) {
+    print_stats_time(1, "avg ", entry.mean);
+    print_stats_time(2, "sd  ", stats_deviation(&entry));
+    print_stats_time(3, "se  ", stats_error(&entry));
+  } else {
+    print_stats_time(1, "min ", entry.min);
+    print_stats_time(2, "max ", entry.max);
+    print_stats_time(3, "rng ", entry.max - entry.min);
+  }
+  display_flush();
+}
+
+/* One configuration per screen, the encoder changes the configuration and the
+ * click changes between spread and range. */
+void Statistics(void *args) {
+  rotary_encoder_event_t e;
+  size_t index = 0;
+  uint8_t page = 0;
+
+  display_clear();
+
+  while (stats_size() > 0) {
+    print_stats(index, page);
+
+    input_receive(qCommand, &e, portMAX_DELAY);
+
+    if (e.type == RE_ET_CHANGED) {
+      index = input_step(index, e.diff, 0, stats_size() - 1);
+    } else if (e.type == RE_ET_BTN_CLICKED) {
+      page ^= 1;
+    }
+  }
+
+  display_puts(9, 1, "no");
+  display_puts(5, 2, "statistics");
+  display_flush();
 
   END_MENU_FUNCTION;
 }
@@ -1211,6 +1688,34 @@ void Change_menu(void *args) {
   END_MENU_FUNCTION;
 }
 
+void Change_result(void *args) {
+  result_mode ^= 1;
+  strncpy(result_mode_label, result_mode_names[result_mode], 16);
+
+  openNVS();
+  nvs_set_u8(nvs, "resultmode", result_mode);
+  nvs_commit(nvs);
+
+  nvs_close(nvs);
+
+  SET_QUICK_FUNCTION;
+  END_MENU_FUNCTION;
+}
+
+void Change_damping(void *args) {
+  damping_mode ^= 1;
+  snprintf(damping_mode_label, 13, "Damping: %s", damping_mode ? "On" : "Off");
+
+  openNVS();
+  nvs_set_u8(nvs, "damping", damping_mode);
+  nvs_commit(nvs);
+
+  nvs_close(nvs);
+
+  SET_QUICK_FUNCTION;
+  END_MENU_FUNCTION;
+}
+
 void print_bar(uint8_t level) {
   char bar[21];
   uint8_t integer = level / 5;
@@ -1222,8 +1727,7 @@ void print_bar(uint8_t level) {
   }
   memset(bar + integer, ' ', 20 - integer);
   bar[20] = '\0';
-  hd44780_gotoxy(&lcd, 0, 2);
-  hd44780_puts(&lcd, bar);
+  display_puts(0, 2, bar);
 }
 
 void Brightness(void *args) {
@@ -1234,27 +1738,21 @@ void Brightness(void *args) {
 
   char percent[5];
 
-  hd44780_clear(&lcd);
-  hd44780_gotoxy(&lcd, 3, 0);
-  hd44780_puts(&lcd, "Set Brightness");
-  hd44780_gotoxy(&lcd, 3, 3);
-  hd44780_puts(&lcd, "Click To Save!");
+  display_clear();
+  display_puts(3, 0, "Set Brightness");
+  display_puts(3, 3, "Click To Save!");
 
   while (e.type != RE_ET_BTN_CLICKED) {
     snprintf(percent, 5, "%03d%%", brightnessTemp);
-    hd44780_gotoxy(&lcd, 8, 1);
-    hd44780_puts(&lcd, percent);
+    display_puts(8, 1, percent);
 
     print_bar(brightnessTemp);
+    display_flush();
 
-    xQueueReceive(qCommand, &e, portMAX_DELAY);
+    input_receive(qCommand, &e, portMAX_DELAY);
 
     if (e.type == RE_ET_CHANGED) {
-      if (e.diff > 0 && brightnessTemp < 100) {
-        brightnessTemp++;
-      } else if (e.diff < 0 && brightnessTemp > 0) {
-        brightnessTemp--;
-      }
+      brightnessTemp = input_step(brightnessTemp, e.diff, 0, 100);
 
       ledc_set_duty(ledMode, ledChannel, PERCENT_TO_10_BIT(brightnessTemp));
       ledc_update_duty(ledMode, ledChannel);
@@ -1274,6 +1772,65 @@ void Brightness(void *args) {
   END_MENU_FUNCTION;
 }
 
+// stages on a page, under the header
+#define LATENCY_ROWS (CONFIG_VERTICAL_SIZE - 1)
+#define LATENCY_GROUPS ((LATENCY_STAGES + LATENCY_ROWS - 1) / LATENCY_ROWS)
+// the times of every group of stages, then their samples
+#define LATENCY_PAGES (2 * LATENCY_GROUPS)
+
+void print_latency(uint8_t page) {
+  latency_histogram_t h;
+  char line[21];
+  bool times = page < LATENCY_GROUPS;
+  uint8_t first = page % LATENCY_GROUPS * LATENCY_ROWS;
+
+  if (times) {
+    display_puts(0, 0, "us   min  p99   max ");
+  } else {
+    display_puts(0, 0, "     samples        ");
+  }
+
+  for (uint8_t row = 0; row < LATENCY_ROWS; row++) {
+    uint8_t stage = first + row;
+    if (stage >= LATENCY_STAGES) {
+      display_clear_line(row + 1);
+      continue;
+    }
+    latency_snapshot(stage, &h);
+    if (times) {
+      snprintf(line, 21, "%s%5" PRIu32 "%5" PRIu32 "%6" PRIu32 " ",
+               latency_stage_label[stage], h.min / 1000,
+               latency_percentile(&h, 99) / 1000, h.max / 1000);
+    } else {
+      snprintf(line, 21, "%s %10" PRIu32 "      ", latency_stage_label[stage],
+               h.count);
+    }
+    display_puts(0, row + 1, line);
+  }
+  display_flush();
+}
+
+/* Show the latency from the sensor edge to the experiment task, a click dumps
+ * the histograms over the serial log. */
+void Diagnostics(void *args) {
+  rotary_encoder_event_t e;
+  uint8_t page = 0;
+
+  display_clear();
+
+  while (true) {
+    print_latency(page);
+
+    if (input_receive(qCommand, &e, pdMS_TO_TICKS(500)) == pdTRUE) {
+      if (e.type == RE_ET_CHANGED) {
+        page = (page + 1) % LATENCY_PAGES;
+      } else if (e.type == RE_ET_BTN_CLICKED) {
+        latency_dump();
+      }
+    }
+  }
+}
+
 void Info(void *args) {
   rotary_encoder_event_t e;
   char *info_text[4] = {
@@ -1293,28 +1850,23 @@ void Info(void *args) {
   char text_line[21];
 
   while (true) {
-    hd44780_clear(&lcd);
+    display_clear();
 
     for (uint8_t i = 0; i < 4; i++) {
       size_t position = (max_scroll[i] > 0) ? min_position[i] : 0;
       strncpy(text_line, info_text[i] + position, 20);
       text_line[20] = '\0';
 
-      hd44780_gotoxy(&lcd, 0, i);
-      hd44780_puts(&lcd, text_line);
+      display_puts(0, i, text_line);
     }
+    display_flush();
 
-    xQueueReceive(qCommand, &e, portMAX_DELAY);
+    input_receive(qCommand, &e, portMAX_DELAY);
 
     if (e.type == RE_ET_CHANGED) {
       for (uint8_t i = 0; i < 4; i++) {
-        if (e.diff > 0) {
-          if (min_position[i] < max_scroll[i])
-            min_position[i]++;
-        } else {
-          if (min_position[i] > 0)
-            min_position[i]--;
-        }
+        min_position[i] =
+            input_step(min_position[i], e.diff, 0, max_scroll[i]);
       }
     } else if (e.type == RE_ET_BTN_CLICKED) {
       memset(min_position, 0, sizeof(min_position));
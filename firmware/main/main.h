@@ -4,7 +4,11 @@
 #include "hal/pcnt_types.h"
 #include <driver/pulse_cnt.h>
 #include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 #include <menu_manager.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
@@ -21,15 +25,23 @@ esp_err_t startNVS(void);
 
 esp_err_t startPWM(void);
 
+// Hourglass
+
+void hourglass_start(void);
+
+void hourglass_stop(void);
+
 // Menu Manager
 
 Navigate_t map(void);
 
+void menu_draw(const char *title, const char *labels[], uint8_t cursor);
+
 void displayNormal(menu_path_t *current_path);
 
 void displayLoop(menu_path_t *current_path);
 
-extern menu_node_t root_options[5];
+extern menu_node_t root_options[6];
 
 // Experiments
 
@@ -38,6 +50,8 @@ typedef struct {
   pcnt_channel_edge_action_t falling;
   pcnt_glitch_filter_config_t filter;
   int32_t watchPoint[2];
+  bool all_edges;           // capture also the edges that PCNT does not count
+  uint32_t min_interval_ns; // the capture rejects the edges closer than it
 } experiment_config_t;
 
 typedef enum {
@@ -48,6 +62,21 @@ typedef enum {
   EXPERIMENT_ERROR,
 } experiment_stage_t;
 
+// Events that wake the experiment task, sent as notification bits
+#define EVENT_SENSOR (1 << 0)
+#define EVENT_COMMAND (1 << 1)
+#define EVENT_REFRESH (1 << 2)
+#define EVENT_POLL (1 << 3)
+
+void refresh_start(void);
+
+void refresh_stop(void);
+
+uint32_t wait_events(void);
+
+extern TaskHandle_t tExperiment;
+extern QueueHandle_t qCommand;
+
 typedef enum {
   ENERGY_SOLID = 0,
   ENERGY_RIRE,
@@ -61,32 +90,50 @@ void Spring(void *args);
 
 void Energy(void *args);
 
-typedef struct {
-  char timed[12];
-  char option[8];
+typedef enum {
+  EXPERIMENT_PENDULUM = 0,
+  EXPERIMENT_SPRING,
+  EXPERIMENT_ENERGY,
+} experiment_kind_t;
+
+// periods of a run, as many as the four digits on the display
+#define EXPERIMENT_MAX_PERIODS 9999
+
+typedef struct __attribute__((packed)) {
+  int64_t timed;         // microseconds
+  uint8_t kind;          // experiment_kind_t
+  uint16_t param;        // periods or energy_t
+  uint8_t mode;          // result_mode_t that gave timed
+  uint32_t fit_error_ns; // standard error of the fitted period, 0 without
 } experiment_data_t;
 
-typedef struct {
-  experiment_data_t *array;
-  size_t size;
-  size_t capability;
-} experiment_data_array_t;
-
-void append_history(experiment_data_t data);
-
-void remove_at_history(size_t index);
+// layout of experiment_data_t in the flash and NVS, changed with it
+#define EXPERIMENT_DATA_FORMAT 3
 
 void History(void *args);
 
+void Statistics(void *args);
+
 // Settings
 
 void Change_menu(void *args);
 
 void Brightness(void *args);
 
+void Change_result(void *args);
+
+void Change_damping(void *args);
+
+void Diagnostics(void *args);
+
 void Info(void *args);
 
-extern menu_node_t settings_options[3];
+extern menu_node_t settings_options[6];
+
+typedef enum {
+  RESULT_TWO_EDGES = 0, // time between the watch points
+  RESULT_FIT,           // least-squares period over every edge
+} result_mode_t;
 
 typedef struct {
   void (*type_menu)(menu_path_t *current_path);
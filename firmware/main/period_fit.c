@@ -0,0 +1,70 @@
+#include <math.h>
+#include <period_fit.h>
+#include <string.h>
+
+void line_fit_add(line_fit_t *line, double x, double y) {
+  double dx = x - line->mean_x;
+  double dy = y - line->mean_y;
+
+  line->n++;
+  line->mean_x += dx / line->n;
+  line->mean_y += dy / line->n;
+  line->sxx += dx * (x - line->mean_x);
+  line->sxy += dx * (y - line->mean_y);
+  line->syy += dy * (y - line->mean_y);
+}
+
+/**
+ * @brief Slope of the line and its standard error
+ *
+ * @return false with less than 3 points, the error is not known
+ */
+bool line_fit_slope(const line_fit_t *line, double *slope, double *error) {
+  if (line->n < 3 || line->sxx <= 0) {
+    return false;
+  }
+
+  double residual = line->syy - line->sxy * line->sxy / line->sxx;
+
+  *slope = line->sxy / line->sxx;
+  *error = residual > 0 ? sqrt(residual / (line->n - 2) / line->sxx) : 0;
+  return true;
+}
+
+/**
+ * @brief Starts a fit over the edges between the watch points
+ */
+void period_fit_reset(period_fit_t *fit, const int32_t watchPoint[2],
+                      uint8_t edges_per_period) {
+  memset(fit, 0, sizeof(*fit));
+  fit->first_count = watchPoint[0];
+  fit->last_count = watchPoint[1];
+  fit->edges_per_period = edges_per_period;
+}
+
+void period_fit_add(period_fit_t *fit, const edge_event_t *edge) {
+  if (!edge->counted || edge->count < fit->first_count ||
+      edge->count > fit->last_count ||
+      (edge->count - fit->first_count) % fit->edges_per_period != 0) {
+    return;
+  }
+
+  if (fit->line.n == 0) {
+    fit->origin = edge->time;
+  }
+
+  line_fit_add(&fit->line,
+               (double)(edge->count - fit->first_count) /
+                   fit->edges_per_period,
+               edge->time - fit->origin);
+}
+
+/**
+ * @brief Period and its standard error, in nanoseconds
+ *
+ * @return false with less than 3 edges, the error is not known
+ */
+bool period_fit_result(const period_fit_t *fit, double *period,
+                       double *error) {
+  return line_fit_slope(&fit->line, period, error);
+}
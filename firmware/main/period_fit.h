@@ -0,0 +1,45 @@
+#ifndef __PERIOD_FIT_H__
+#define __PERIOD_FIT_H__
+
+#include <capture.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Period Fit
+/* Least-squares line over the time of every edge in phase with the first
+ * one, the slope is the period. The sums are updated online with co-moments,
+ * so the memory is constant and the precision holds for long runs. The
+ * experiments add the edges from the sink of their run as they are drained,
+ * the edges past the end of the run buffer too. */
+
+typedef struct {
+  uint32_t n;
+  double mean_x;
+  double mean_y;
+  double sxx;
+  double sxy;
+  double syy;
+} line_fit_t;
+
+typedef struct {
+  uint32_t first_count;
+  uint32_t last_count;
+  uint8_t edges_per_period;
+  int64_t origin; // nanoseconds of the first edge added
+  line_fit_t line; // nanoseconds from the origin over periods
+} period_fit_t;
+
+void line_fit_add(line_fit_t *line, double x, double y);
+
+bool line_fit_slope(const line_fit_t *line, double *slope, double *error);
+
+void period_fit_reset(period_fit_t *fit, const int32_t watchPoint[2],
+                      uint8_t edges_per_period);
+
+void period_fit_add(period_fit_t *fit, const edge_event_t *edge);
+
+bool period_fit_result(const period_fit_t *fit, double *period,
+                       double *error);
+
+#endif // __PERIOD_FIT_H__
@@ -0,0 +1,451 @@
+#include <replay.h>
+#include <sdkconfig.h>
+
+#if CONFIG_IDF_TARGET_LINUX
+#include <capture.h>
+#include <driver/gpio.h>
+#include <driver/pulse_cnt.h>
+#include <esp_log.h>
+#include <event_script.h>
+#include <filter.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <history.h>
+#include <i2cdev.h>
+#include <inttypes.h>
+#include <latency.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <virtual_clock.h>
+
+#define REPLAY_MAX_EDGES 4096
+#define REPLAY_GLITCH_NS 50    // under the 100ns of the glitch filter
+#define REPLAY_CHATTER_NS 1000 // between the glitches after an edge
+#define REPLAY_NOISE_NS 2000   // over the glitch filter, the PCNT counts it
+#define REPLAY_NOISE_GAP_NS 5000
+// After the last edge, the glitch filter lets it through meanwhile
+#define REPLAY_TAIL_NS 1000000
+// The display flushes on frames of real time, longer than one of them
+#define REPLAY_FRAME_WAIT_MS 100
+
+static const char *TAG = "replay";
+
+typedef enum {
+  SHAPE_PERIODIC = 0,
+  SHAPE_JITTERED,
+  SHAPE_BURSTY,
+  SHAPE_GLITCHY,
+  SHAPE_NOISY,
+  SHAPE_ISOLATED,
+  SHAPE_RECORDED,
+} replay_shape_t;
+
+static const char *shape_names[] = {"periodic", "jittered", "bursty",
+                                    "glitchy",  "noisy",    "isolated",
+                                    "recorded"};
+
+typedef struct {
+  int64_t time; // ns from the start of the trace
+  bool level;
+  bool real; // false for a glitch
+} replay_edge_t;
+
+typedef struct {
+  replay_shape_t shape;
+  bool played;
+  int64_t truth;      // ns from the first to the last real rising edge
+  double seconds;     // host time to play the trace
+  int64_t worst_edge; // host ns from an edge to the firmware idle again
+  uint32_t reached;   // watch points before the trace
+  uint32_t overruns;  // of the capture ring before the trace
+  size_t results;     // in the history before the trace
+} replay_run_t;
+
+static replay_edge_t trace[REPLAY_MAX_EDGES];
+static size_t trace_size = 0;
+static replay_run_t last;
+static uint32_t random_state = 1;
+static bool header = false;
+static i2c_dev_fake_stats_t last_frame;
+static bool frame_header = false;
+
+static int64_t host_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// xorshift32, the same trace for the same seed
+static uint32_t next_random(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+static bool push(int64_t time, bool level, bool real) {
+  if (trace_size == REPLAY_MAX_EDGES) {
+    return false;
+  }
+  trace[trace_size++] = (replay_edge_t){
+      .time = time,
+      .level = level,
+      .real = real,
+  };
+  return true;
+}
+
+static int64_t ground_truth(void) {
+  const replay_edge_t *first = NULL, *lest = NULL;
+
+  for (size_t i = 0; i < trace_size; i++) {
+    if (trace[i].real && trace[i].level) {
+      if (first == NULL) {
+        first = &trace[i];
+      }
+      lest = &trace[i];
+    }
+  }
+  return first != NULL ? lest->time - first->time : 0;
+}
+
+/**
+ * @brief Passes of a shape, a pass is a rising edge and a falling one width
+ * later, interval after the previous pass
+ *
+ * @param amount Jitter of a pass, passes in a burst, glitches after an edge or
+ * glitches between two passes
+ */
+static bool generate(replay_shape_t shape, int passes, int64_t interval,
+                     int64_t width, int64_t amount) {
+  trace_size = 0;
+
+  for (int i = 0; i < passes; i++) {
+    int64_t time = i * interval;
+
+    if (shape == SHAPE_JITTERED) {
+      // within +-amount of i * interval + amount, never before the start
+      time += next_random() % (2 * amount + 1);
+    } else if (shape == SHAPE_BURSTY) {
+      time = (i / amount) * interval + (i % amount) * 2 * width;
+    }
+
+    if (!push(time, true, true)) {
+      return false;
+    }
+    // chatter of the beam while it starts to be cut
+    for (int64_t k = 0; shape == SHAPE_GLITCHY && k < amount; k++) {
+      int64_t glitch = time + (k + 1) * REPLAY_CHATTER_NS;
+      if (!push(glitch, false, false) ||
+          !push(glitch + REPLAY_GLITCH_NS, true, false)) {
+        return false;
+      }
+    }
+    // the same, with pulses the glitch filter lets through
+    for (int64_t k = 0; shape == SHAPE_NOISY && k < amount; k++) {
+      int64_t noise = time + (k + 1) * REPLAY_NOISE_GAP_NS;
+      if (!push(noise, false, false) ||
+          !push(noise + REPLAY_NOISE_NS, true, false)) {
+        return false;
+      }
+    }
+    if (!push(time + width, false, true)) {
+      return false;
+    }
+    // glitches alone while the beam is free, far from any edge
+    for (int64_t k = 0;
+         shape == SHAPE_ISOLATED && i < passes - 1 && k < amount; k++) {
+      int64_t gap = (interval - width) / (amount + 1);
+      int64_t glitch = time + width + (k + 1) * gap;
+      if (!push(glitch, true, false) ||
+          !push(glitch + REPLAY_GLITCH_NS, false, false)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void play(replay_shape_t shape) {
+  int64_t start = virtual_clock_now_ns();
+
+  last.shape = shape;
+  last.truth = ground_truth();
+  last.worst_edge = 0;
+  last.reached = pcnt_fake_reached();
+  last.overruns = capture_overruns();
+  last.results = history_size();
+  latency_reset();
+
+  int64_t begin = host_ns();
+  for (size_t i = 0; i < trace_size; i++) {
+    int64_t edge = host_ns();
+
+    virtual_clock_advance(start + trace[i].time);
+    gpio_fake_set_level(CONFIG_SENSOR_IR, trace[i].level);
+    event_script_settle();
+
+    int64_t handling = host_ns() - edge;
+    if (handling > last.worst_edge) {
+      last.worst_edge = handling;
+    }
+  }
+  virtual_clock_advance(virtual_clock_now_ns() + REPLAY_TAIL_NS);
+  event_script_settle();
+
+  last.seconds = (host_ns() - begin) / 1e9;
+  last.played = true;
+}
+
+static bool trace_event(char *args) {
+  char shape_name[16], interval_text[24], width_text[24], amount_text[24];
+  int passes;
+  unsigned seed = 1;
+  int64_t interval, width, amount = 0;
+
+  int fields = sscanf(args, "%15s %d %23s %23s %23s %u", shape_name, &passes,
+                      interval_text, width_text, amount_text, &seed);
+  if (fields < 4 || passes < 2 ||
+      !event_script_duration(interval_text, &interval) ||
+      !event_script_duration(width_text, &width) || width >= interval) {
+    return false;
+  }
+
+  replay_shape_t shape = SHAPE_PERIODIC;
+  while (shape < SHAPE_RECORDED && strcmp(shape_name, shape_names[shape])) {
+    shape++;
+  }
+
+  switch (shape) {
+  case SHAPE_PERIODIC:
+    break;
+  case SHAPE_JITTERED:
+    // a jitter that keeps the passes in order
+    if (fields < 5 || !event_script_duration(amount_text, &amount) ||
+        2 * amount >= interval - width) {
+      return false;
+    }
+    random_state = seed != 0 ? seed : 1;
+    break;
+  case SHAPE_BURSTY:
+    amount = strtol(amount_text, NULL, 10);
+    if (fields < 5 || amount < 1 || amount * 2 * width >= interval) {
+      return false;
+    }
+    break;
+  case SHAPE_GLITCHY:
+    amount = strtol(amount_text, NULL, 10);
+    if (fields < 5 || amount < 0 ||
+        (amount + 1) * REPLAY_CHATTER_NS >= width) {
+      return false;
+    }
+    break;
+  case SHAPE_NOISY:
+    amount = strtol(amount_text, NULL, 10);
+    if (fields < 5 || amount < 0 ||
+        (amount + 1) * REPLAY_NOISE_GAP_NS >= width) {
+      return false;
+    }
+    break;
+  case SHAPE_ISOLATED:
+    amount = strtol(amount_text, NULL, 10);
+    if (fields < 5 || amount < 0 ||
+        (amount + 1) * REPLAY_CHATTER_NS >= interval - width) {
+      return false;
+    }
+    break;
+  default:
+    return false;
+  }
+
+  if (!generate(shape, passes, interval, width, amount)) {
+    ESP_LOGE(TAG, "more than %d edges", REPLAY_MAX_EDGES);
+    return false;
+  }
+  play(shape);
+  return true;
+}
+
+/* Edges of the first run of a CSV of tools/stream_decode. A recording of the
+ * counted edges only gets the other edge back halfway between them. */
+static bool replay_event(char *args) {
+  char path[128], line[256];
+
+  if (sscanf(args, "%127s", path) != 1) {
+    return false;
+  }
+  FILE *csv = fopen(path, "r");
+  if (csv == NULL) {
+    ESP_LOGE(TAG, "cannot open %s", path);
+    return false;
+  }
+
+  int64_t first = -1;
+  bool fits = true;
+  trace_size = 0;
+  while (fits && fgets(line, sizeof(line), csv) != NULL) {
+    unsigned sequence;
+    uint32_t count;
+    int64_t time;
+    int rising, counted;
+
+    if (strncmp(line, "end,", 4) == 0 && trace_size > 0) {
+      break;
+    }
+    if (sscanf(line, "edge,%u,%" SCNu32 ",%" SCNd64 ",%d,%d", &sequence,
+               &count, &time, &rising, &counted) != 5) {
+      continue;
+    }
+    if (first < 0) {
+      first = time;
+    }
+    time -= first;
+
+    if (trace_size > 0 && trace[trace_size - 1].level == rising) {
+      fits = push((trace[trace_size - 1].time + time) / 2, !rising, true);
+    } else if (trace_size == 0 && !rising) {
+      continue;
+    }
+    fits = fits && push(time, rising, true);
+  }
+  fclose(csv);
+
+  if (fits && trace_size > 0 && trace[trace_size - 1].level) {
+    fits = push(trace[trace_size - 1].time + REPLAY_TAIL_NS, false, true);
+  }
+  if (!fits || trace_size < 2) {
+    ESP_LOGE(TAG, "%s: %zu edges", path, trace_size);
+    return false;
+  }
+
+  play(SHAPE_RECORDED);
+  return true;
+}
+
+static bool measure_event(char *args) {
+  char gate[24];
+  double tolerance = INFINITY;
+  uint32_t allowed = UINT32_MAX;
+
+  int fields = sscanf(args, "%23s %" SCNu32, gate, &allowed);
+  if (fields < 1 || !last.played) {
+    return false;
+  }
+  // "-" only reports the run
+  bool gated = strcmp(gate, "-") != 0;
+  if (gated) {
+    char *end;
+    tolerance = strtod(gate, &end);
+    if (*end != '\0') {
+      return false;
+    }
+    if (fields < 2) {
+      allowed = 0;
+    }
+  }
+  last.played = false;
+
+  size_t results = history_size();
+  experiment_data_t data;
+  bool stored = results > last.results && history_at(results - 1, &data);
+
+  latency_histogram_t handoff;
+  latency_snapshot(LATENCY_ISR_TO_TASK, &handoff);
+  uint32_t reached = pcnt_fake_reached() - last.reached;
+  uint32_t lost = reached > handoff.count ? reached - handoff.count : 0;
+  uint32_t overruns = capture_overruns() - last.overruns;
+
+  double measured = stored ? data.timed : NAN;
+  double error = measured - last.truth / 1000.0;
+
+  if (!header) {
+    printf("bench,shape,edges,edges_per_s,worst_edge_us,worst_isr_task_us,"
+           "lost_stamps,overruns,rejected,truth_us,measured_us,error_us\n");
+    header = true;
+  }
+  printf("bench,%s,%zu,%.0f,%.1f,%.1f,%" PRIu32 ",%" PRIu32 ",%" PRIu32
+         ",%.3f,%.0f,%.3f\n",
+         shape_names[last.shape], trace_size, trace_size / last.seconds,
+         last.worst_edge / 1000.0, handoff.max / 1000.0, lost, overruns,
+         capture_rejected(), last.truth / 1000.0, measured, error);
+  fflush(stdout);
+
+  if (gated &&
+      (!stored || fabs(error) > tolerance || lost + overruns > allowed)) {
+    ESP_LOGE(TAG, "%s out of the gate: error %.3fus, dropped %" PRIu32,
+             shape_names[last.shape], error, lost + overruns);
+    event_script_fail();
+  }
+  return true;
+}
+
+/* The filter of the next runs: glitch filter in ns, minimum interval. */
+static bool filter_event(char *args) {
+  char interval_text[24];
+  unsigned long glitch;
+  int64_t interval;
+
+  if (sscanf(args, "%lu %23s", &glitch, interval_text) != 2 ||
+      !event_script_duration(interval_text, &interval) ||
+      glitch > FILTER_MAX_GLITCH_NS ||
+      interval > (int64_t)FILTER_MAX_INTERVAL_US * 1000) {
+    return false;
+  }
+
+  filter_settings_t settings = {
+      .glitch_ns = glitch,
+      .min_interval_ns = interval,
+  };
+  return filter_set(&settings) == ESP_OK;
+}
+
+/* The LCD traffic since the last frame event, and its time on the wire at
+ * CONFIG_DISPLAY_I2C_FREQ: 9 bits for the address and each byte. */
+static bool frame_event(char *args) {
+  unsigned long allowed = ULONG_MAX;
+
+  if (*args != '\0' && sscanf(args, "%lu", &allowed) != 1) {
+    return false;
+  }
+  vTaskDelay(pdMS_TO_TICKS(REPLAY_FRAME_WAIT_MS));
+
+  i2c_dev_fake_stats_t now = i2c_dev_fake_stats();
+  uint32_t transactions = now.transactions - last_frame.transactions;
+  uint32_t bytes = now.bytes - last_frame.bytes;
+  double wire = (transactions + bytes) * 9 * 1e6 / CONFIG_DISPLAY_I2C_FREQ;
+  last_frame = now;
+
+  if (!frame_header) {
+    printf("frame,transactions,bytes,wire_us\n");
+    frame_header = true;
+  }
+  printf("frame,%" PRIu32 ",%" PRIu32 ",%.0f\n", transactions, bytes, wire);
+  fflush(stdout);
+
+  if (bytes > allowed) {
+    ESP_LOGE(TAG, "frame of %" PRIu32 " bytes, over %lu", bytes, allowed);
+    event_script_fail();
+  }
+  return true;
+}
+
+esp_err_t replay_init(void) {
+  ESP_ERROR_CHECK(event_script_add("filter", filter_event));
+  ESP_ERROR_CHECK(event_script_add("trace", trace_event));
+  ESP_ERROR_CHECK(event_script_add("replay", replay_event));
+  ESP_ERROR_CHECK(event_script_add("measure", measure_event));
+  ESP_ERROR_CHECK(event_script_add("frame", frame_event));
+  return ESP_OK;
+}
+
+#else
+
+esp_err_t replay_init(void) { return ESP_OK; }
+
+#endif // CONFIG_IDF_TARGET_LINUX
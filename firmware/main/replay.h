@@ -0,0 +1,27 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <esp_err.h>
+
+// Replay
+/* Benchmark of the host build, events of the event script that play edge
+ * traces on the sensor and check the result of the experiment:
+ *   trace periodic <passes> <interval> <width>
+ *   trace jittered <passes> <interval> <width> <jitter> [seed]
+ *   trace bursty <passes> <interval> <width> <passes per burst>
+ *   trace glitchy <passes> <interval> <width> <glitches per pass>
+ *   trace noisy <passes> <interval> <width> <noise pulses per pass>
+ *   replay <csv of tools/stream_decode>
+ *   measure <tolerance us> [dropped allowed]
+ *   filter <glitch ns> <minimum interval>
+ *   frame [bytes allowed]
+ * measure prints a "bench,..." line with the throughput, the worst handling
+ * time, the dropped and rejected events and the error against the ground
+ * truth of the trace, and fails the script past the tolerance. filter sets
+ * the filter of the next runs. frame prints a "frame,..." line with the LCD
+ * traffic since the last one, to profile what a screen sends. Nothing on the
+ * device. */
+
+esp_err_t replay_init(void);
+
+#endif // __REPLAY_H__
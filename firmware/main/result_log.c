@@ -0,0 +1,457 @@
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <nvs.h>
+#include <result_log.h>
+#include <stats.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timing.h>
+
+#define RECORD_LIVE 0x80000000
+#define RECORD_EMPTY 0xFFFFFFFF
+#define SECTOR_SIZE 4096
+#define SECTOR_RECORDS (SECTOR_SIZE / sizeof(result_record_t))
+#define PAGE_RECORDS 16
+#define SECTOR_NONE 0xFFFFFFFF
+
+_Static_assert(sizeof(result_record_t) == RESULT_RECORD_SIZE,
+               "record must fill RESULT_RECORD_SIZE bytes");
+
+static const char *TAG = "result_log";
+
+static const esp_partition_t *partition = NULL;
+static SemaphoreHandle_t sLog = NULL;
+static esp_timer_handle_t flush_timer = NULL;
+static TaskHandle_t tFlush = NULL;
+
+static uint32_t capacity; // records in the partition
+static uint32_t head = 0; // sequence of the next record
+static uint32_t tail = 0; // sequence of the oldest record
+
+// records not written yet, the first one is head - pending_count
+static result_record_t pending[RESULT_LOG_BATCH];
+static size_t pending_count = 0;
+
+// one bit per slot, set when the result was removed
+static uint32_t *removed = NULL;
+static uint32_t removed_count = 0;
+static uint16_t *sector_removed = NULL; // removed results of each sector
+
+// last flash page read by the History
+static result_record_t cache[PAGE_RECORDS];
+static uint32_t cache_page = RECORD_EMPTY;
+
+static inline uint32_t slot(uint32_t sequence) { return sequence % capacity; }
+
+static inline bool is_removed(uint32_t sequence) {
+  uint32_t s = slot(sequence);
+  return removed[s / 32] & (1U << (s % 32));
+}
+
+/* The removed bit is out of the CRC, so it can be cleared in place. */
+static uint16_t record_crc(const result_record_t *record) {
+  uint32_t sequence = record->sequence | RECORD_LIVE;
+  uint16_t crc =
+      esp_rom_crc16_le(0, (const uint8_t *)&sequence, sizeof(sequence));
+  return esp_rom_crc16_le(crc, (const uint8_t *)&record->data,
+                          sizeof(record->data));
+}
+
+static bool record_valid(const result_record_t *record, uint32_t sequence) {
+  return record->sequence != RECORD_EMPTY &&
+         (record->sequence & ~RECORD_LIVE) == sequence &&
+         record->crc == record_crc(record);
+}
+
+static esp_err_t read_record(uint32_t sequence, result_record_t *record) {
+  return esp_partition_read(partition, slot(sequence) * sizeof(*record), record,
+                            sizeof(*record));
+}
+
+/* Each sector keeps its slice of the removed bitmap under its own key, so a
+ * removal or an erase rewrites SECTOR_RECORDS / 8 bytes of NVS, not the
+ * bitmap of the whole partition. */
+static void sector_key(uint32_t sector, char key[16]) {
+  snprintf(key, 16, "rm%" PRIu32, sector);
+}
+
+/* The sector is the one whose removed bits changed, or SECTOR_NONE. */
+static esp_err_t save_index(uint32_t sector) {
+  nvs_handle_t nvs;
+  char key[16];
+  esp_err_t err = nvs_open("rlog", NVS_READWRITE, &nvs);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  nvs_set_u8(nvs, "format", EXPERIMENT_DATA_FORMAT);
+  nvs_set_u32(nvs, "head", head - pending_count);
+  nvs_set_u32(nvs, "tail", tail);
+  if (sector != SECTOR_NONE) {
+    sector_key(sector, key);
+    if (sector_removed[sector] > 0) {
+      nvs_set_blob(nvs, key, &removed[sector * SECTOR_RECORDS / 32],
+                   SECTOR_RECORDS / 8);
+    } else {
+      nvs_erase_key(nvs, key);
+    }
+  }
+  err = nvs_commit(nvs);
+  nvs_close(nvs);
+  return err;
+}
+
+/* Drops the index of a log with another format, with the removed bits of
+ * every sector. */
+static esp_err_t reset_index(void) {
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open("rlog", NVS_READWRITE, &nvs);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  nvs_erase_all(nvs);
+  err = nvs_commit(nvs);
+  nvs_close(nvs);
+  return err == ESP_OK ? save_index(SECTOR_NONE) : err;
+}
+
+/* False when the log was written with another layout of the results. */
+static bool load_index(void) {
+  nvs_handle_t nvs;
+  char key[16];
+  uint8_t format = 0;
+
+  if (nvs_open("rlog", NVS_READONLY, &nvs) != ESP_OK) {
+    ESP_LOGW(TAG, "The log is empty!");
+    return true;
+  }
+
+  nvs_get_u8(nvs, "format", &format);
+  if (format != EXPERIMENT_DATA_FORMAT) {
+    nvs_close(nvs);
+    return false;
+  }
+
+  nvs_get_u32(nvs, "head", &head);
+  nvs_get_u32(nvs, "tail", &tail);
+  for (uint32_t sector = 0; sector < capacity / SECTOR_RECORDS; sector++) {
+    uint32_t *bits = &removed[sector * SECTOR_RECORDS / 32];
+    size_t size = SECTOR_RECORDS / 8;
+
+    sector_key(sector, key);
+    if (nvs_get_blob(nvs, key, bits, &size) != ESP_OK) {
+      memset(bits, 0, SECTOR_RECORDS / 8);
+    }
+    for (uint32_t i = 0; i < SECTOR_RECORDS / 32; i++) {
+      sector_removed[sector] += __builtin_popcount(bits[i]);
+    }
+    removed_count += sector_removed[sector];
+  }
+  nvs_close(nvs);
+  return true;
+}
+
+static void clear_sector(uint32_t sector) {
+  memset(&removed[sector * SECTOR_RECORDS / 32], 0, SECTOR_RECORDS / 8);
+  removed_count -= sector_removed[sector];
+  sector_removed[sector] = 0;
+}
+
+/* A reset between the flash write and the NVS commit leaves the index a batch
+ * behind, it is fixed looking only at the head and the tail. A sector erased
+ * by that batch still has its old removed bits in NVS. */
+static void recover_index(void) {
+  result_record_t record;
+  uint32_t found = 0;
+  uint32_t erased = SECTOR_NONE;
+
+  while (found < capacity && read_record(head, &record) == ESP_OK &&
+         record_valid(&record, head)) {
+    if (slot(head) % SECTOR_RECORDS == 0) {
+      erased = slot(head) / SECTOR_RECORDS;
+      clear_sector(erased);
+    }
+    head++;
+    found++;
+  }
+
+  if (head != tail &&
+      (read_record(tail, &record) != ESP_OK || !record_valid(&record, tail))) {
+    // the sector of the tail was already erased ahead of the head
+    tail += SECTOR_RECORDS - slot(tail) % SECTOR_RECORDS;
+    if (tail > head) {
+      tail = head;
+    }
+  }
+
+  if (found > 0) {
+    save_index(erased);
+  }
+}
+
+/* Frees the sector starting at the sequence, the oldest results are lost. */
+static esp_err_t erase_sector(uint32_t sequence) {
+  uint32_t first = slot(sequence);
+
+  if (sequence >= capacity && tail < sequence - capacity + SECTOR_RECORDS) {
+    tail = sequence - capacity + SECTOR_RECORDS;
+  }
+
+  clear_sector(first / SECTOR_RECORDS);
+
+  return esp_partition_erase_range(partition, first * sizeof(result_record_t),
+                                   SECTOR_SIZE);
+}
+
+static esp_err_t flush_locked(void) {
+  esp_err_t err = ESP_OK;
+  uint32_t sequence = head - pending_count;
+  uint32_t erased = SECTOR_NONE; // a batch never spans two sectors
+  size_t i = 0;
+
+  if (pending_count == 0) {
+    return ESP_OK;
+  }
+
+  // a batch is split only at the end of a sector
+  while (i < pending_count && err == ESP_OK) {
+    uint32_t s = slot(sequence + i);
+    size_t run = SECTOR_RECORDS - s % SECTOR_RECORDS;
+    if (run > pending_count - i) {
+      run = pending_count - i;
+    }
+
+    if (s % SECTOR_RECORDS == 0) {
+      err = erase_sector(sequence + i);
+      erased = s / SECTOR_RECORDS;
+    }
+    if (err == ESP_OK) {
+      err = esp_partition_write(partition, s * sizeof(result_record_t),
+                                &pending[i], run * sizeof(result_record_t));
+    }
+    i += run;
+  }
+
+  cache_page = RECORD_EMPTY;
+  pending_count = 0;
+
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Error (%s) writing the log!", esp_err_to_name(err));
+    return err;
+  }
+
+  return save_index(erased);
+}
+
+/* The erase and the write of the flash take milliseconds, they are done by a
+ * low priority task and not on the esp_timer task. The statistics are saved
+ * with the batch. */
+static void flush_task(void *args) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    result_log_flush();
+    stats_save();
+  }
+}
+
+static void flush_callback(void *args) { xTaskNotifyGive(tFlush); }
+
+/**
+ * @brief Opens the log in the "results" partition
+ */
+esp_err_t result_log_init(void) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                       RESULT_LOG_SUBTYPE, "results");
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "No results partition!");
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  capacity = partition->size / SECTOR_SIZE * SECTOR_RECORDS;
+  if (capacity < 2 * SECTOR_RECORDS) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  removed = calloc(capacity / 32, sizeof(uint32_t));
+  sector_removed = calloc(capacity / SECTOR_RECORDS, sizeof(uint16_t));
+  sLog = xSemaphoreCreateMutex();
+  if (removed == NULL || sector_removed == NULL || sLog == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  const esp_timer_create_args_t timer_args = {
+      .callback = &flush_callback,
+      .name = "result_log",
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &flush_timer));
+
+  if (xTaskCreatePinnedToCore(&flush_task, "result_log", 3072, NULL, 1,
+                              &tFlush, UI_CORE) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (load_index()) {
+    recover_index();
+  } else {
+    // the first sector is erased, so no old record is taken for a new one
+    ESP_LOGW(TAG, "The log has an old format, it starts over!");
+    ESP_ERROR_CHECK(esp_partition_erase_range(partition, 0, SECTOR_SIZE));
+    ESP_ERROR_CHECK(reset_index());
+  }
+
+  ESP_LOGI(TAG, "%" PRIu32 " results, %" PRIu32 " removed, capacity %" PRIu32,
+           head - tail, removed_count, capacity);
+
+  return ESP_OK;
+}
+
+/**
+ * @brief Appends a result, it goes to the flash with its batch
+ */
+esp_err_t result_log_append(const experiment_data_t *data) {
+  esp_err_t err = ESP_OK;
+
+  xSemaphoreTake(sLog, portMAX_DELAY);
+
+  result_record_t *record = &pending[pending_count];
+  record->sequence = head | RECORD_LIVE;
+  record->data = *data;
+  record->crc = record_crc(record);
+  memset(record->unused, 0xFF, sizeof(record->unused));
+  pending_count++;
+  head++;
+
+  if (pending_count == RESULT_LOG_BATCH) {
+    err = flush_locked();
+  }
+
+  xSemaphoreGive(sLog);
+
+  // a few results will not wait a full batch
+  esp_timer_stop(flush_timer);
+  esp_timer_start_once(flush_timer, RESULT_LOG_FLUSH_US);
+
+  return err;
+}
+
+/**
+ * @brief Writes the batch in progress
+ */
+esp_err_t result_log_flush(void) {
+  xSemaphoreTake(sLog, portMAX_DELAY);
+  esp_err_t err = flush_locked();
+  xSemaphoreGive(sLog);
+  return err;
+}
+
+/* Sequence of the result at the position, skipping the removed ones. Whole
+ * sectors are skipped by their count, so only one sector is walked. */
+static uint32_t find_sequence(size_t index) {
+  uint32_t written = head - pending_count;
+  uint32_t sequence = tail;
+
+  while (sequence < written) {
+    uint32_t s = slot(sequence);
+    uint32_t live = SECTOR_RECORDS - sector_removed[s / SECTOR_RECORDS];
+
+    if (s % SECTOR_RECORDS == 0 && sequence + SECTOR_RECORDS <= written &&
+        index >= live) {
+      index -= live;
+      sequence += SECTOR_RECORDS;
+    } else {
+      if (!is_removed(sequence)) {
+        if (index == 0) {
+          return sequence;
+        }
+        index--;
+      }
+      sequence++;
+    }
+  }
+
+  // the pending results are never removed
+  return index < head - written ? written + index : RECORD_EMPTY;
+}
+
+/**
+ * @brief Removes the result, clearing its live bit in the flash
+ */
+esp_err_t result_log_remove_at(size_t index) {
+  esp_err_t err;
+
+  xSemaphoreTake(sLog, portMAX_DELAY);
+
+  // only written records are removed, the flush may erase the oldest ones
+  uint32_t sequence = find_sequence(index);
+  err = flush_locked();
+
+  if (err == ESP_OK && sequence != RECORD_EMPTY && sequence >= tail) {
+    uint32_t s = slot(sequence);
+    err = esp_partition_write(partition, s * sizeof(result_record_t),
+                              &sequence, sizeof(sequence));
+    if (err == ESP_OK) {
+      removed[s / 32] |= 1U << (s % 32);
+      sector_removed[s / SECTOR_RECORDS]++;
+      removed_count++;
+      cache_page = RECORD_EMPTY;
+      err = save_index(s / SECTOR_RECORDS);
+    }
+  }
+
+  xSemaphoreGive(sLog);
+  return err;
+}
+
+size_t result_log_size(void) {
+  xSemaphoreTake(sLog, portMAX_DELAY);
+  size_t size = head - tail - removed_count;
+  xSemaphoreGive(sLog);
+  return size;
+}
+
+/**
+ * @brief Copies the result at the position, 0 is the oldest
+ *
+ * False when the position is out of the log or the record is broken.
+ */
+bool result_log_at(size_t index, experiment_data_t *data) {
+  bool found = false;
+
+  xSemaphoreTake(sLog, portMAX_DELAY);
+
+  uint32_t sequence = find_sequence(index);
+  uint32_t written = head - pending_count;
+
+  if (sequence == RECORD_EMPTY) {
+    // out of the log
+  } else if (sequence >= written) {
+    *data = pending[sequence - written].data;
+    found = true;
+  } else {
+    uint32_t s = slot(sequence);
+    uint32_t page = s / PAGE_RECORDS;
+
+    if (page != cache_page &&
+        esp_partition_read(partition, page * sizeof(cache), cache,
+                           sizeof(cache)) == ESP_OK) {
+      cache_page = page;
+    }
+
+    if (page == cache_page &&
+        record_valid(&cache[s % PAGE_RECORDS], sequence)) {
+      *data = cache[s % PAGE_RECORDS].data;
+      found = true;
+    }
+  }
+
+  xSemaphoreGive(sLog);
+  return found;
+}
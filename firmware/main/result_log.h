@@ -0,0 +1,45 @@
+#ifndef __RESULT_LOG_H__
+#define __RESULT_LOG_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Result Log
+/* Append-only log of results in the "results" partition. Records are written
+ * in batches, each one with its own CRC, a batch not full goes out
+ * RESULT_LOG_FLUSH_US after the last result from a low priority task. The log
+ * turns around the partition erasing one sector ahead of the head, so the
+ * wear is spread over all sectors. Head, tail and the removed records of each
+ * sector are kept in NVS, so the boot never scans the log. A log written
+ * with another EXPERIMENT_DATA_FORMAT starts over. */
+
+#define RESULT_LOG_SUBTYPE 0x40
+#define RESULT_LOG_BATCH 16
+#define RESULT_LOG_FLUSH_US 2000000
+// a power of two, so a sector holds whole records
+#define RESULT_RECORD_SIZE 32
+
+typedef struct __attribute__((packed)) {
+  uint32_t sequence; // bit 31 is cleared in flash when the result is removed
+  experiment_data_t data;
+  uint16_t crc;
+  uint8_t unused[RESULT_RECORD_SIZE - sizeof(uint32_t) -
+                 sizeof(experiment_data_t) - sizeof(uint16_t)]; // left erased
+} result_record_t;
+
+esp_err_t result_log_init(void);
+
+esp_err_t result_log_append(const experiment_data_t *data);
+
+esp_err_t result_log_flush(void);
+
+esp_err_t result_log_remove_at(size_t index);
+
+size_t result_log_size(void);
+
+bool result_log_at(size_t index, experiment_data_t *data);
+
+#endif // __RESULT_LOG_H__
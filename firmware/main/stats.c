@@ -0,0 +1,236 @@
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <math.h>
+#include <nvs.h>
+#include <sdkconfig.h>
+#include <stats.h>
+#include <string.h>
+
+static const char *TAG = "stats";
+
+static stats_entry_t entries[CONFIG_STATS_SLOTS];
+static size_t entries_count = 0;
+static uint32_t updates = 0;
+static bool dirty = false; // updated since the last save
+static SemaphoreHandle_t sStats = NULL;
+
+// copy being saved, so the runs do not wait for NVS
+static stats_entry_t saving[CONFIG_STATS_SLOTS];
+static SemaphoreHandle_t sSave = NULL;
+
+/**
+ * @brief Loads the statistics saved with the history
+ */
+esp_err_t stats_init(void) {
+  nvs_handle_t nvs;
+  size_t size = sizeof(entries);
+
+  sStats = xSemaphoreCreateMutex();
+  sSave = xSemaphoreCreateMutex();
+  if (sStats == NULL || sSave == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (nvs_open("rlog", NVS_READONLY, &nvs) != ESP_OK) {
+    return ESP_OK;
+  }
+  // entries saved with another layout of the results are left behind
+  uint8_t format = 0;
+  nvs_get_u8(nvs, "stats_format", &format);
+  if (format == EXPERIMENT_DATA_FORMAT &&
+      nvs_get_blob(nvs, "stats", entries, &size) == ESP_OK) {
+    entries_count = size / sizeof(entries[0]);
+  }
+  nvs_close(nvs);
+
+  for (size_t i = 0; i < entries_count; i++) {
+    if (entries[i].used > updates) {
+      updates = entries[i].used;
+    }
+  }
+
+  return ESP_OK;
+}
+
+/* Entry of the configuration, a new one takes the least used slot. */
+static stats_entry_t *find_entry(const experiment_data_t *data) {
+  stats_entry_t *oldest = &entries[0];
+
+  for (size_t i = 0; i < entries_count; i++) {
+    if (entries[i].kind == data->kind && entries[i].param == data->param &&
+        entries[i].mode == data->mode) {
+      return &entries[i];
+    }
+    if (entries[i].used < oldest->used) {
+      oldest = &entries[i];
+    }
+  }
+
+  if (entries_count < CONFIG_STATS_SLOTS) {
+    oldest = &entries[entries_count++];
+  }
+
+  memset(oldest, 0, sizeof(*oldest));
+  oldest->kind = data->kind;
+  oldest->param = data->param;
+  oldest->mode = data->mode;
+  return oldest;
+}
+
+/**
+ * @brief Adds the result of a run to the statistics of its configuration
+ */
+void stats_add(const experiment_data_t *data) {
+  xSemaphoreTake(sStats, portMAX_DELAY);
+
+  stats_entry_t *entry = find_entry(data);
+  double delta = data->timed - entry->mean;
+
+  entry->count++;
+  entry->mean += delta / entry->count;
+  entry->m2 += delta * (data->timed - entry->mean);
+
+  if (entry->count == 1 || data->timed < entry->min) {
+    entry->min = data->timed;
+  }
+  if (entry->count == 1 || data->timed > entry->max) {
+    entry->max = data->timed;
+  }
+  entry->used = ++updates;
+  dirty = true;
+
+  xSemaphoreGive(sStats);
+}
+
+/**
+ * @brief Takes the result of a run back out of the statistics of its
+ * configuration
+ *
+ * The Welford update is reversed. The minimum and maximum can not be, the
+ * ones of the results of the configuration left in the history replace them
+ * when the removed result was one of them, or the mean once none is left.
+ *
+ * @param min Smallest result of the configuration left in the history,
+ * INT64_MAX for none
+ * @param max Largest result of the configuration left in the history,
+ * INT64_MIN for none
+ */
+void stats_remove(const experiment_data_t *data, int64_t min, int64_t max) {
+  xSemaphoreTake(sStats, portMAX_DELAY);
+
+  stats_entry_t *entry = NULL;
+  for (size_t i = 0; i < entries_count && entry == NULL; i++) {
+    if (entries[i].kind == data->kind && entries[i].param == data->param &&
+        entries[i].mode == data->mode) {
+      entry = &entries[i];
+    }
+  }
+  // the entry was replaced since, or never had the result
+  if (entry == NULL || entry->count == 0) {
+    xSemaphoreGive(sStats);
+    return;
+  }
+
+  if (entry->count == 1) {
+    // the last result, the configuration leaves the statistics
+    size_t index = entry - entries;
+    memmove(entry, entry + 1,
+            (entries_count - index - 1) * sizeof(entries[0]));
+    entries_count--;
+  } else {
+    double mean = entry->mean;
+
+    entry->count--;
+    entry->mean = (mean * (entry->count + 1) - data->timed) / entry->count;
+    entry->m2 -= (data->timed - entry->mean) * (data->timed - mean);
+    if (entry->m2 < 0) {
+      entry->m2 = 0; // rounding
+    }
+
+    if (data->timed <= entry->min) {
+      entry->min = min != INT64_MAX ? min : (int64_t)entry->mean;
+    }
+    if (data->timed >= entry->max) {
+      entry->max = max != INT64_MIN ? max : (int64_t)entry->mean;
+    }
+  }
+  dirty = true;
+
+  xSemaphoreGive(sStats);
+}
+
+/**
+ * @brief Saves the statistics in NVS, if a run updated them since the last
+ * save
+ *
+ * Called with the flush of the results and when an experiment is left, never
+ * after each run.
+ */
+esp_err_t stats_save(void) {
+  nvs_handle_t nvs;
+  esp_err_t err = ESP_OK;
+
+  xSemaphoreTake(sSave, portMAX_DELAY);
+
+  xSemaphoreTake(sStats, portMAX_DELAY);
+  bool changed = dirty;
+  size_t count = entries_count;
+  memcpy(saving, entries, count * sizeof(entries[0]));
+  dirty = false;
+  xSemaphoreGive(sStats);
+
+  if (changed) {
+    err = nvs_open("rlog", NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+      nvs_set_u8(nvs, "stats_format", EXPERIMENT_DATA_FORMAT);
+      nvs_set_blob(nvs, "stats", saving, count * sizeof(saving[0]));
+      err = nvs_commit(nvs);
+      nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Error (%s) saving statistics!", esp_err_to_name(err));
+    }
+  }
+
+  xSemaphoreGive(sSave);
+  return err;
+}
+
+size_t stats_size(void) { return entries_count; }
+
+/**
+ * @brief Copy of the entry, in the order they were first seen
+ */
+bool stats_get(size_t index, stats_entry_t *entry) {
+  bool found = false;
+
+  xSemaphoreTake(sStats, portMAX_DELAY);
+  if (index < entries_count) {
+    *entry = entries[index];
+    found = true;
+  }
+  xSemaphoreGive(sStats);
+
+  return found;
+}
+
+/**
+ * @brief Sample standard deviation, in microseconds
+ */
+double stats_deviation(const stats_entry_t *entry) {
+  if (entry->count < 2) {
+    return 0;
+  }
+  return sqrt(entry->m2 / (entry->count - 1));
+}
+
+/**
+ * @brief Standard error of the mean, in microseconds
+ */
+double stats_error(const stats_entry_t *entry) {
+  if (entry->count < 2) {
+    return 0;
+  }
+  return stats_deviation(entry) / sqrt(entry->count);
+}
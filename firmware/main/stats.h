@@ -0,0 +1,47 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <esp_err.h>
+#include <main.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Statistics
+/* Running aggregates of the runs for each experiment configuration, "Pen05"
+ * or "Spr10" for example, apart for each result mode. Every run updates them
+ * in O(1) with the Welford method, the history is never scanned again. A
+ * result removed from the history is taken back out the same way, only its
+ * minimum or maximum is then found again among the results left. They are
+ * saved in NVS with the flush of the result log and when an experiment is
+ * left, not after each run. */
+
+typedef struct {
+  uint8_t kind;   // experiment_kind_t
+  uint16_t param; // periods or energy_t
+  uint8_t mode;   // result_mode_t
+  uint32_t count;
+  uint32_t used; // order of the last update, the oldest is replaced
+  double mean;   // microseconds
+  double m2;     // sum of squared differences from the mean
+  int64_t min;
+  int64_t max;
+} stats_entry_t;
+
+esp_err_t stats_init(void);
+
+void stats_add(const experiment_data_t *data);
+
+void stats_remove(const experiment_data_t *data, int64_t min, int64_t max);
+
+esp_err_t stats_save(void);
+
+size_t stats_size(void);
+
+bool stats_get(size_t index, stats_entry_t *entry);
+
+double stats_deviation(const stats_entry_t *entry);
+
+double stats_error(const stats_entry_t *entry);
+
+#endif // __STATS_H__
@@ -0,0 +1,162 @@
+#include <sdkconfig.h>
+#include <stream.h>
+#include <stream_frame.h>
+
+#if CONFIG_EDGE_STREAM
+#include <driver/uart.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string.h>
+#include <timing.h>
+
+#define STREAM_UART CONFIG_ESP_CONSOLE_UART_NUM
+
+static const char *TAG = "stream";
+
+static TaskHandle_t tStream = NULL;
+static SemaphoreHandle_t sBuffers = NULL;
+
+// only the experiment task writes frames, only tStream sends, the swap of the
+// buffers happens on either side with sBuffers held
+static uint8_t buffers[2][STREAM_BUFFER_SIZE];
+static uint8_t active = 0;
+static size_t fill = 0;
+static size_t sending = 0;
+static bool busy = false;
+static bool pending = false; // a flush found the sender busy
+
+static uint16_t sequence = 0;
+static uint32_t dropped = 0;
+
+/* Hands the active buffer to the sender, false while it sends the other.
+ * Called with sBuffers held. */
+static bool swap(void) {
+  if (busy) {
+    return false;
+  }
+
+  sending = fill;
+  active ^= 1;
+  fill = 0;
+  busy = true;
+  xTaskNotifyGive(tStream);
+  return true;
+}
+
+static void send_task(void *args) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uart_write_bytes(STREAM_UART, buffers[active ^ 1], sending);
+
+    xSemaphoreTake(sBuffers, portMAX_DELAY);
+    busy = false;
+    if (pending && fill > 0) {
+      swap();
+    }
+    pending = false;
+    xSemaphoreGive(sBuffers);
+  }
+}
+
+static void write_frame(uint8_t type, const uint8_t *payload, size_t len) {
+  uint8_t encoded[STREAM_ENCODED_MAX];
+  size_t size = stream_frame_encode(type, sequence++, payload, len, encoded);
+
+  xSemaphoreTake(sBuffers, portMAX_DELAY);
+  if (fill + size > STREAM_BUFFER_SIZE && !swap()) {
+    dropped++;
+  } else {
+    memcpy(buffers[active] + fill, encoded, size);
+    fill += size;
+  }
+  xSemaphoreGive(sBuffers);
+}
+
+esp_err_t stream_init(void) {
+  if (!uart_is_driver_installed(STREAM_UART)) {
+    ESP_ERROR_CHECK(uart_driver_install(STREAM_UART, 256, 0, 0, NULL, 0));
+  }
+
+  sBuffers = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(&send_task, "stream", 2048, NULL, 1, &tStream,
+                          UI_CORE);
+
+  ESP_LOGI(TAG, "Streaming edges on UART%d", STREAM_UART);
+  return ESP_OK;
+}
+
+void stream_edges(const edge_event_t *events, size_t n) {
+  uint8_t payload[STREAM_PAYLOAD_MAX];
+
+  while (n > 0) {
+    uint8_t batch = n < STREAM_EDGES_PER_FRAME ? n : STREAM_EDGES_PER_FRAME;
+    uint8_t *p = payload;
+
+    *p++ = batch;
+    for (uint8_t i = 0; i < batch; i++) {
+      stream_put_u32(p, events[i].count);
+      stream_put_u64(p + 4, events[i].time);
+      p[12] = (events[i].rising ? STREAM_FLAG_RISING : 0) |
+              (events[i].counted ? STREAM_FLAG_COUNTED : 0);
+      p += STREAM_EDGE_SIZE;
+    }
+    write_frame(STREAM_EDGES, payload, p - payload);
+
+    events += batch;
+    n -= batch;
+  }
+}
+
+void stream_run_start(const experiment_config_t *config) {
+  uint8_t payload[9];
+
+  stream_put_u32(payload, config->watchPoint[0]);
+  stream_put_u32(payload + 4, config->watchPoint[1]);
+  payload[8] = config->all_edges;
+  write_frame(STREAM_RUN_START, payload, sizeof(payload));
+}
+
+void stream_run_end(const experiment_data_t *data) {
+  uint8_t payload[20];
+
+  stream_put_u64(payload, data->timed);
+  payload[8] = data->kind;
+  stream_put_u16(payload + 9, data->param);
+  payload[11] = data->mode;
+  stream_put_u32(payload + 12, data->fit_error_ns);
+  stream_put_u32(payload + 16, dropped);
+  write_frame(STREAM_RUN_END, payload, sizeof(payload));
+  stream_flush();
+}
+
+/**
+ * @brief Sends what is buffered, or once the sender is done with the other
+ * buffer
+ */
+void stream_flush(void) {
+  xSemaphoreTake(sBuffers, portMAX_DELAY);
+  if (fill > 0 && !swap()) {
+    pending = true;
+  }
+  xSemaphoreGive(sBuffers);
+}
+
+uint32_t stream_dropped(void) { return dropped; }
+
+#else
+
+esp_err_t stream_init(void) { return ESP_OK; }
+
+void stream_edges(const edge_event_t *events, size_t n) {}
+
+void stream_run_start(const experiment_config_t *config) {}
+
+void stream_run_end(const experiment_data_t *data) {}
+
+void stream_flush(void) {}
+
+uint32_t stream_dropped(void) { return 0; }
+
+#endif // CONFIG_EDGE_STREAM
@@ -0,0 +1,36 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <capture.h>
+#include <esp_err.h>
+#include <main.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Edge Stream
+/* Edges and run markers go out of the console UART as binary frames, see
+ * stream_frame.h. Frames are written into one of two buffers while a low
+ * priority task sends the other one, when both are busy the frame is dropped
+ * and the host sees the gap in the sequence. A flush that finds the sender
+ * busy is done by the sender when it is free, so the end of a run always goes
+ * out. Both sides take the lock of the buffers only to copy a frame or swap
+ * the buffers, the sender releases it before the UART write, so the
+ * experiment task may wait for a swap but never for the UART. The stream
+ * takes the console UART in place of the commands, see CONSOLE_UART.
+ * tools/stream_decode.c turns the stream into CSV. */
+
+#define STREAM_BUFFER_SIZE 1024
+
+esp_err_t stream_init(void);
+
+void stream_edges(const edge_event_t *events, size_t n);
+
+void stream_run_start(const experiment_config_t *config);
+
+void stream_run_end(const experiment_data_t *data);
+
+void stream_flush(void);
+
+uint32_t stream_dropped(void);
+
+#endif // __STREAM_H__
@@ -0,0 +1,88 @@
+#include <stream_frame.h>
+#include <string.h>
+
+uint16_t stream_crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * @brief Builds a frame and writes it COBS encoded, between delimiters
+ *
+ * @param out At least STREAM_ENCODED_MAX bytes
+ * @return Bytes written
+ */
+size_t stream_frame_encode(uint8_t type, uint16_t sequence,
+                           const uint8_t *payload, size_t len, uint8_t *out) {
+  uint8_t frame[STREAM_FRAME_MAX];
+  size_t size = 0;
+
+  if (len > STREAM_PAYLOAD_MAX) {
+    return 0;
+  }
+
+  frame[size++] = type;
+  stream_put_u16(frame + size, sequence);
+  size += 2;
+  memcpy(frame + size, payload, len);
+  size += len;
+  stream_put_u16(frame + size, stream_crc16(frame, size));
+  size += 2;
+
+  // every zero becomes the distance to the next zero
+  out[0] = 0;
+  size_t code_at = 1;
+  size_t n = 2;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < size; i++) {
+    if (frame[i] == 0) {
+      out[code_at] = code;
+      code_at = n++;
+      code = 1;
+    } else {
+      out[n++] = frame[i];
+      if (++code == 0xFF) {
+        out[code_at] = code;
+        code_at = n++;
+        code = 1;
+      }
+    }
+  }
+  out[code_at] = code;
+  out[n++] = 0;
+
+  return n;
+}
+
+/**
+ * @brief Decodes one COBS block, without its delimiter
+ *
+ * @return Bytes decoded, 0 if the block is broken
+ */
+size_t stream_cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t n = 0;
+  size_t i = 0;
+
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t k = 1; k < code; k++) {
+      out[n++] = in[i++];
+    }
+    if (code < 0xFF && i < len) {
+      out[n++] = 0;
+    }
+  }
+
+  return n;
+}
@@ -0,0 +1,66 @@
+#ifndef __STREAM_FRAME_H__
+#define __STREAM_FRAME_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream Frame
+/* Frames of the edge stream, shared by the firmware and the host decoder.
+ *
+ * [type u8][sequence u16][payload][crc16 u16], all little endian, the CRC is
+ * CRC-16/CCITT-FALSE over type, sequence and payload. The frame is COBS
+ * encoded between two 0x00, so the decoder finds the next frame after a loss
+ * or after text of the log mixed on the same UART. */
+
+#define STREAM_EDGES_PER_FRAME 16
+#define STREAM_EDGE_SIZE 13
+#define STREAM_PAYLOAD_MAX (1 + STREAM_EDGES_PER_FRAME * STREAM_EDGE_SIZE)
+#define STREAM_FRAME_MAX (3 + STREAM_PAYLOAD_MAX + 2)
+// COBS adds a byte every 254, plus the delimiters
+#define STREAM_ENCODED_MAX (STREAM_FRAME_MAX + STREAM_FRAME_MAX / 254 + 3)
+
+typedef enum {
+  STREAM_EDGES = 1, // [n u8] n x [count u32][time ns i64][flags u8]
+  STREAM_RUN_START, // [watch point 0 i32][watch point 1 i32][all edges u8]
+  STREAM_RUN_END,   // [timed us i64][kind u8][param u16][mode u8]
+                    // [fit error ns u32][dropped frames u32]
+} stream_type_t;
+
+#define STREAM_FLAG_RISING (1 << 0)
+#define STREAM_FLAG_COUNTED (1 << 1)
+
+static inline void stream_put_u16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static inline void stream_put_u32(uint8_t *p, uint32_t v) {
+  stream_put_u16(p, v);
+  stream_put_u16(p + 2, v >> 16);
+}
+
+static inline void stream_put_u64(uint8_t *p, uint64_t v) {
+  stream_put_u32(p, v);
+  stream_put_u32(p + 4, v >> 32);
+}
+
+static inline uint16_t stream_get_u16(const uint8_t *p) {
+  return p[0] | (uint16_t)p[1] << 8;
+}
+
+static inline uint32_t stream_get_u32(const uint8_t *p) {
+  return stream_get_u16(p) | (uint32_t)stream_get_u16(p + 2) << 16;
+}
+
+static inline uint64_t stream_get_u64(const uint8_t *p) {
+  return stream_get_u32(p) | (uint64_t)stream_get_u32(p + 4) << 32;
+}
+
+uint16_t stream_crc16(const uint8_t *data, size_t len);
+
+size_t stream_frame_encode(uint8_t type, uint16_t sequence,
+                           const uint8_t *payload, size_t len, uint8_t *out);
+
+size_t stream_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+#endif // __STREAM_FRAME_H__
@@ -0,0 +1,79 @@
+#include <time_format.h>
+
+static inline uint32_t clamp(int64_t microsecond) {
+  if (microsecond < 0) {
+    return 0;
+  }
+  if (microsecond > TIME_FORMAT_MAX) {
+    return TIME_FORMAT_MAX;
+  }
+  return microsecond;
+}
+
+static inline void put_group(char *string, uint32_t value) {
+  string[2] = '0' + value % 10;
+  value /= 10;
+  string[1] = '0' + value % 10;
+  string[0] = '0' + value / 10;
+}
+
+/**
+ * @brief Writes the time as "SSS,mmm uuu", it saturates at 999,999 999
+ */
+void time_format(int64_t microsecond, char string[TIME_FORMAT_LEN + 1]) {
+  uint32_t value = clamp(microsecond);
+  uint32_t milliseconds = value / 1000;
+
+  put_group(string + 8, value - milliseconds * 1000);
+  put_group(string + 4, milliseconds % 1000);
+  put_group(string, milliseconds / 1000);
+  string[3] = ',';
+  string[7] = ' ';
+  string[TIME_FORMAT_LEN] = '\0';
+}
+
+/**
+ * @brief Next update rewrites every digit, used after the display is cleared
+ */
+void time_odometer_reset(time_odometer_t *odometer) {
+  time_format(0, odometer->text);
+  odometer->value = 0;
+  odometer->stale = true;
+}
+
+/**
+ * @brief Updates only the digits that changed since the last time
+ *
+ * Digits are made from the right and it stops once the part left is the same
+ * as before, so a frame of 40 ms usually touches the lowest five digits.
+ *
+ * @return Position of the first changed char, TIME_FORMAT_LEN if none
+ */
+uint8_t time_odometer_update(time_odometer_t *odometer, int64_t microsecond) {
+  uint32_t now = clamp(microsecond);
+  uint32_t before = odometer->value;
+  uint8_t first = TIME_FORMAT_LEN;
+
+  for (int8_t i = TIME_FORMAT_LEN - 1;
+       i >= 0 && (odometer->stale || now != before); i--) {
+    if (i == 3 || i == 7) {
+      continue;
+    }
+
+    char digit = '0' + now % 10;
+    if (odometer->text[i] != digit || odometer->stale) {
+      odometer->text[i] = digit;
+      first = i;
+    }
+    now /= 10;
+    before /= 10;
+  }
+
+  if (odometer->stale) {
+    first = 0;
+  }
+  odometer->value = clamp(microsecond);
+  odometer->stale = false;
+
+  return first;
+}
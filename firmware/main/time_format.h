@@ -0,0 +1,26 @@
+#ifndef __TIME_FORMAT_H__
+#define __TIME_FORMAT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Time Format
+/* Times are shown as "SSS,mmm uuu" using only integer division, no double is
+ * touched. Plain C, so it also builds on the host for the benchmark. */
+
+#define TIME_FORMAT_LEN 11
+#define TIME_FORMAT_MAX 999999999
+
+typedef struct {
+  char text[TIME_FORMAT_LEN + 1];
+  uint32_t value;
+  bool stale;
+} time_odometer_t;
+
+void time_format(int64_t microsecond, char string[TIME_FORMAT_LEN + 1]);
+
+void time_odometer_reset(time_odometer_t *odometer);
+
+uint8_t time_odometer_update(time_odometer_t *odometer, int64_t microsecond);
+
+#endif // __TIME_FORMAT_H__
@@ -0,0 +1,94 @@
+#include <capture.h>
+#include <display.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <gate.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <timing.h>
+
+static const char *TAG = "timing";
+
+static TaskHandle_t tStress = NULL;
+static uint32_t stress_seconds = 0;
+
+typedef struct {
+  TaskHandle_t caller;
+  esp_err_t err;
+} timing_start_t;
+
+static void timing_task(void *args) {
+  timing_start_t *start = (timing_start_t *)args;
+
+  // interrupts are allocated on the core that installs them
+  start->err = gate_init();
+  if (start->err == ESP_OK) {
+    start->err = capture_init();
+  }
+  xTaskNotifyGive(start->caller);
+
+  for (;;) {
+    gate_dispatch(portMAX_DELAY);
+  }
+}
+
+esp_err_t timing_init(void) {
+  timing_start_t start = {
+      .caller = xTaskGetCurrentTaskHandle(),
+      .err = ESP_FAIL,
+  };
+
+  if (xTaskCreatePinnedToCore(&timing_task, "timing", 3072, &start,
+                              CONFIG_TIMING_PRIORITY, NULL,
+                              TIMING_CORE) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  ESP_LOGI(TAG, "Timing on core %d, UI on core %d", TIMING_CORE, UI_CORE);
+  return start.err;
+}
+
+static void stress_task(void *args) {
+  int64_t end = esp_timer_get_time() + (int64_t)stress_seconds * 1000000;
+  char line[CONFIG_HORIZONTAL_SIZE + 1];
+  uint32_t frame = 0;
+
+  while (esp_timer_get_time() < end) {
+    for (uint8_t y = 0; y < CONFIG_VERTICAL_SIZE; y++) {
+      for (uint8_t x = 0; x < CONFIG_HORIZONTAL_SIZE; x++) {
+        line[x] = '!' + (frame + x + y) % 94;
+      }
+      line[CONFIG_HORIZONTAL_SIZE] = '\0';
+      display_puts(0, y, line);
+    }
+    display_flush();
+    frame++;
+    vTaskDelay(pdMS_TO_TICKS(1000 / CONFIG_DISPLAY_FPS));
+  }
+
+  display_clear();
+  display_flush();
+  ESP_LOGI(TAG, "Stress done, %" PRIu32 " frames", frame);
+  tStress = NULL;
+  vTaskDelete(NULL);
+}
+
+/**
+ * @brief Redraw the whole screen every frame on UI_CORE for a while
+ *
+ * @param seconds How long the load lasts
+ */
+esp_err_t timing_stress(uint32_t seconds) {
+  if (tStress != NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  stress_seconds = seconds;
+  if (xTaskCreatePinnedToCore(&stress_task, "stress", 2048, NULL, 1, &tStress,
+                              UI_CORE) != pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
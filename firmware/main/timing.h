@@ -0,0 +1,26 @@
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include <stdint.h>
+
+// Timing
+/* Placement of the work on the two cores. The timing task is pinned to
+ * TIMING_CORE: it allocates the PCNT and capture interrupts from there, so
+ * that core serves them, and hands the stamps of the gates to the experiments
+ * at TIMING_PRIORITY. The menu, the display, NVS and the stream stay on
+ * UI_CORE, where the I2C traffic of the LCD does not delay a stamp.
+ *
+ * timing_stress() loads UI_CORE with full screen redraws as fast as the
+ * display takes them. Runs with TIMING_CORE set to UI_CORE and then apart,
+ * both under stress, give the before and after of the "latency" command. */
+
+#define TIMING_CORE CONFIG_TIMING_CORE
+#define UI_CORE CONFIG_UI_CORE
+
+esp_err_t timing_init(void);
+
+esp_err_t timing_stress(uint32_t seconds);
+
+#endif // __TIMING_H__
@@ -0,0 +1,123 @@
+/* Host decoder of the edge stream, binary frames in and CSV out.
+ *
+ * Build from the repository root:
+ *   cc -O2 -Ifirmware/main tools/stream_decode.c \
+ *      firmware/main/stream_frame.c -o stream_decode
+ *
+ * Read the console UART of the device, the text of the log mixed in the
+ * stream is skipped:
+ *   stty -F /dev/ttyUSB0 115200 raw && ./stream_decode < /dev/ttyUSB0
+ *
+ * One row per edge or marker, a "lost" row tells how many frames are missing
+ * before a sequence number. Broken frames are counted on stderr. */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stream_frame.h>
+
+#define ENCODED_BUFFER (STREAM_ENCODED_MAX + 1)
+
+static uint32_t broken = 0;
+
+static void print_frame(const uint8_t *frame, size_t size) {
+  static bool synced = false;
+  static uint16_t expected;
+
+  if (size < 5 || stream_crc16(frame, size - 2) !=
+                      stream_get_u16(frame + size - 2)) {
+    broken++;
+    return;
+  }
+
+  uint8_t type = frame[0];
+  uint16_t sequence = stream_get_u16(frame + 1);
+  const uint8_t *p = frame + 3;
+  size_t len = size - 5;
+
+  if (synced && sequence != expected) {
+    printf("lost,%u,,,,,,,,,,,,,%u\n", sequence,
+           (uint16_t)(sequence - expected));
+  }
+  synced = true;
+  expected = sequence + 1;
+
+  switch (type) {
+  case STREAM_EDGES:
+    if (len < 1 || len != 1 + (size_t)p[0] * STREAM_EDGE_SIZE) {
+      broken++;
+      return;
+    }
+    for (uint8_t i = 0; i < p[0]; i++) {
+      const uint8_t *edge = p + 1 + i * STREAM_EDGE_SIZE;
+      printf("edge,%u,%" PRIu32 ",%" PRId64 ",%d,%d,,,,,,,,,\n", sequence,
+             stream_get_u32(edge), (int64_t)stream_get_u64(edge + 4),
+             !!(edge[12] & STREAM_FLAG_RISING),
+             !!(edge[12] & STREAM_FLAG_COUNTED));
+    }
+    break;
+
+  case STREAM_RUN_START:
+    if (len != 9) {
+      broken++;
+      return;
+    }
+    printf("start,%u,,,,,%" PRId32 ",%" PRId32 ",%d,,,,,,\n", sequence,
+           (int32_t)stream_get_u32(p), (int32_t)stream_get_u32(p + 4), p[8]);
+    break;
+
+  case STREAM_RUN_END:
+    if (len != 20) {
+      broken++;
+      return;
+    }
+    printf("end,%u,,,,,,,,%u,%u,%" PRId64 ",%u,%" PRIu32 ",%" PRIu32 "\n",
+           sequence, p[8], stream_get_u16(p + 9), (int64_t)stream_get_u64(p),
+           p[11], stream_get_u32(p + 12), stream_get_u32(p + 16));
+    break;
+
+  default:
+    broken++;
+  }
+}
+
+int main(void) {
+  uint8_t encoded[ENCODED_BUFFER];
+  uint8_t frame[ENCODED_BUFFER];
+  size_t n = 0;
+  bool overflow = false;
+  int c;
+
+  printf("record,sequence,count,time_ns,rising,counted,watch0,watch1,"
+         "all_edges,kind,param,timed_us,mode,fit_error_ns,dropped\n");
+
+  while ((c = getchar()) != EOF) {
+    if (c != 0) {
+      if (n < sizeof(encoded)) {
+        encoded[n++] = c;
+      } else {
+        overflow = true;
+      }
+      continue;
+    }
+
+    // log text between frames does not decode or fails the CRC
+    if (overflow) {
+      broken++;
+    } else if (n > 0) {
+      size_t size = stream_cobs_decode(encoded, n, frame);
+      if (size > 0) {
+        print_frame(frame, size);
+      } else {
+        broken++;
+      }
+    }
+    n = 0;
+    overflow = false;
+    fflush(stdout);
+  }
+
+  fprintf(stderr, "broken frames: %" PRIu32 "\n", broken);
+  return 0;
+}
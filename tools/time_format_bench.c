@@ -0,0 +1,88 @@
+/* Host benchmark of the time formatting used by the display.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -Ifirmware/main tools/time_format_bench.c \
+ *      firmware/main/time_format.c -o time_format_bench && ./time_format_bench
+ *
+ * The host has a hardware FPU, so the gap is smaller than on the ESP32 where
+ * the double math of the old routine is emulated. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <time_format.h>
+
+#define FRAMES 1000000
+#define FRAME_US 40000
+
+// the routine used before, kept as reference
+static void micro_to_second(int64_t microsecond, char *string) {
+  double seconds = microsecond / 1000000.0;
+  unsigned int int_seconds = (unsigned int)seconds;
+  unsigned int milliseconds = (unsigned int)((seconds - int_seconds) * 1000);
+  unsigned int microseconds_part =
+      (unsigned int)(((seconds - int_seconds) * 1000 - milliseconds) * 1000);
+  snprintf(string, 12, "%03d,%03d %03d", int_seconds, milliseconds,
+           microseconds_part);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// a running clock as the refresh sees it, with the jitter of the display
+static int64_t frame_time(uint32_t frame) {
+  return (int64_t)frame * FRAME_US + (frame * 2654435761U) % 10000;
+}
+
+int main(void) {
+  char reference[TIME_FORMAT_LEN + 1];
+  char string[TIME_FORMAT_LEN + 1];
+  time_odometer_t odometer;
+  volatile char sink = 0;
+  uint32_t mismatches = 0;
+  uint64_t changed = 0;
+
+  // the double routine truncates 21 us to "000,000 020", count those
+  for (int64_t us = 0; us < 20000000; us += 7) {
+    micro_to_second(us, reference);
+    time_format(us, string);
+    if (strcmp(reference, string) != 0) {
+      mismatches++;
+    }
+  }
+
+  double start = now_ns();
+  for (uint32_t i = 0; i < FRAMES; i++) {
+    micro_to_second(frame_time(i) % TIME_FORMAT_MAX, reference);
+    sink ^= reference[10];
+  }
+  double old_ns = (now_ns() - start) / FRAMES;
+
+  start = now_ns();
+  for (uint32_t i = 0; i < FRAMES; i++) {
+    time_format(frame_time(i) % TIME_FORMAT_MAX, string);
+    sink ^= string[10];
+  }
+  double format_ns = (now_ns() - start) / FRAMES;
+
+  time_odometer_reset(&odometer);
+  start = now_ns();
+  for (uint32_t i = 0; i < FRAMES; i++) {
+    uint8_t first =
+        time_odometer_update(&odometer, frame_time(i) % TIME_FORMAT_MAX);
+    changed += TIME_FORMAT_LEN - first;
+  }
+  double odometer_ns = (now_ns() - start) / FRAMES;
+
+  printf("micro_to_second  %8.1f ns/frame\n", old_ns);
+  printf("time_format      %8.1f ns/frame\n", format_ns);
+  printf("odometer         %8.1f ns/frame, %.2f chars redrawn\n", odometer_ns,
+         (double)changed / FRAMES);
+  printf("times the double routine is off:    %u\n", mismatches);
+
+  return sink == 0x7F;
+}